@@ -47,17 +47,15 @@ void setup() {
     meo.addFeatureMethod("turn_on", onTurnOn);
 
     meo.start();
-}
 
-void loop() {
-    meo.loop();
-
-    static unsigned long last = 0;
-    if (millis() - last > 5000) {
-        last = millis();
+    meo.every(5000, []() {
         MeoEventPayload p;
         p["temperature"] = "23.5";
         p["humidity"] = "50";
         meo.publishEvent("sensor_update", p);
-    }
+    });
+}
+
+void loop() {
+    meo.loop();
 }
\ No newline at end of file
@@ -0,0 +1,214 @@
+// Fleet smoke test: runs a handful of virtual MEO devices from a single board
+// against a gateway. It checks that several MeoDevice instances coexist and
+// gives rough registration, publish and invoke numbers; it is not a load test
+// (one ESP32 cannot hold more than a few MQTT connections).
+// All devices share the WiFi link and are driven from one loop() (no thread
+// per device). Every device gets its own MAC and NVS namespace so it registers
+// and stores credentials independently.
+#include <Meo3_Device.h>
+#include <algorithm>
+#include <vector>
+
+// Pass credentials as build flags, e.g. -D WIFI_SSID=\"my-ssid\"
+#ifndef WIFI_SSID
+#define WIFI_SSID             "your-ssid"
+#endif
+#ifndef WIFI_PASSWORD
+#define WIFI_PASSWORD         "your-password"
+#endif
+#ifndef GATEWAY_HOST
+#define GATEWAY_HOST          "meo-open-service.local"
+#endif
+
+// Each device holds one TCP socket; registration briefly needs a UDP socket
+// and a TCP listener on top. The default lwIP configuration of Arduino-ESP32
+// allows 16 sockets in total.
+#define FLEET_SIZE            8
+#define PUBLISH_INTERVAL_MS   5000
+#define REPORT_INTERVAL_MS    10000
+#define LATENCY_SAMPLES       256
+#define COMPACT_TOPICS        false   // compare bytes/msg with the gateway in either mode
+#define REGISTER_RETRY_MS     5000    // first retry after a failed start(), doubled up to 60 s
+
+#if defined(CONFIG_LWIP_MAX_SOCKETS)
+static_assert(FLEET_SIZE + 2 <= CONFIG_LWIP_MAX_SOCKETS,
+              "FLEET_SIZE exceeds the lwIP socket limit (CONFIG_LWIP_MAX_SOCKETS)");
+#endif
+
+MeoDevice* fleet[FLEET_SIZE];
+bool       registered[FLEET_SIZE];
+unsigned long nextPublish[FLEET_SIZE];
+unsigned long nextRegisterAttempt[FLEET_SIZE];
+unsigned long registerBackoff[FLEET_SIZE];
+int        registerCursor = 0;
+
+// --- Statistics ---
+unsigned long fleetStart = 0;
+unsigned long registrationMs[FLEET_SIZE];
+int           registeredCount = 0;
+unsigned long publishCount = 0;
+unsigned long invokeCount = 0;
+unsigned long invokeLatencyUs[LATENCY_SAMPLES];  // receive -> response published, on the device
+int           invokeLatencyNext = 0;
+int           invokeLatencyFilled = 0;
+
+void recordInvokeLatency(unsigned long us) {
+    invokeLatencyUs[invokeLatencyNext] = us;
+    invokeLatencyNext = (invokeLatencyNext + 1) % LATENCY_SAMPLES;
+    if (invokeLatencyFilled < LATENCY_SAMPLES) invokeLatencyFilled++;
+}
+
+unsigned long percentile(std::vector<unsigned long>& sorted, int pct) {
+    if (sorted.empty()) return 0;
+    size_t idx = (sorted.size() - 1) * pct / 100;
+    return sorted[idx];
+}
+
+// Virtual devices stay quiet unless something goes wrong
+void fleetLogger(const char* level, const char* message) {
+    if (strcmp(level, "ERROR") == 0 || strcmp(level, "WARN") == 0) {
+        Serial.print("[");
+        Serial.print(level);
+        Serial.print("] ");
+        Serial.println(message);
+    }
+}
+
+void setupVirtualDevice(int index) {
+    MeoDevice* dev = new MeoDevice();
+    fleet[index] = dev;
+    registered[index] = false;
+    nextRegisterAttempt[index] = 0;
+    registerBackoff[index] = REGISTER_RETRY_MS;
+
+    // Derive a locally administered MAC and an NVS namespace per device
+    char mac[18];
+    snprintf(mac, sizeof(mac), "02:4D:45:4F:%02X:%02X", (index >> 8) & 0xFF, index & 0xFF);
+    char ns[16];
+    snprintf(ns, sizeof(ns), "meo3v%d", index);
+
+    dev->setLogger(fleetLogger);
+    dev->setCompactTopics(COMPACT_TOPICS);
+    dev->setMacAddress(mac);
+    dev->setStorageNamespace(ns);
+    // A failed registration blocks loop() for its whole timeout; without the TCP
+    // fallback that stays below the MQTT keep-alive of the devices already online
+    dev->setRegistrationTcpFallback(false);
+    dev->beginWifi(WIFI_SSID, WIFI_PASSWORD);
+    dev->begin(GATEWAY_HOST, 1883);
+
+    String label = "Virtual Sensor " + String(index);
+    dev->setDeviceInfo(label.c_str(), "Fleet Smoke Test", "ThingAI Lab", MeoConnectionType::LAN);
+
+    dev->addFeatureEvent("humid_temp_update");
+    dev->addFeatureMethod("echo", [dev](const MeoFeatureCall& call) {
+        dev->sendFeatureResponse(call, true, "echo");
+        // Device side only; the gateway measures the full round trip with "_ping"
+        recordInvokeLatency(micros() - call.trace.receivedUs);
+        invokeCount++;
+    });
+
+    // Stagger publishes so the fleet does not fire in bursts
+    nextPublish[index] = millis() + (PUBLISH_INTERVAL_MS * (unsigned long)index) / FLEET_SIZE;
+}
+
+// Tries the next due unregistered device (round robin), so one unreachable
+// device cannot hold back the ones after it
+void registerNext() {
+    unsigned long now = millis();
+    for (int n = 0; n < FLEET_SIZE; n++) {
+        int i = (registerCursor + n) % FLEET_SIZE;
+        if (registered[i] || (long)(now - nextRegisterAttempt[i]) < 0) {
+            continue;
+        }
+        registerCursor = (i + 1) % FLEET_SIZE;
+
+        unsigned long t0 = millis();
+        if (fleet[i]->start()) {
+            registered[i] = true;
+            registrationMs[registeredCount++] = millis() - t0;
+        } else {
+            nextRegisterAttempt[i] = millis() + registerBackoff[i];
+            registerBackoff[i] = std::min(registerBackoff[i] * 2, 60000UL);
+        }
+        return;
+    }
+}
+
+void report() {
+    unsigned long elapsed = millis() - fleetStart;
+    Serial.printf("--- fleet: %d/%d registered after %lu ms\n", registeredCount, FLEET_SIZE, elapsed);
+
+    if (registeredCount > 0) {
+        std::vector<unsigned long> reg(registrationMs, registrationMs + registeredCount);
+        std::sort(reg.begin(), reg.end());
+        Serial.printf("    registration: p50 %lu ms, p90 %lu ms, max %lu ms\n",
+                      percentile(reg, 50), percentile(reg, 90), reg.back());
+    }
+
+    static unsigned long lastPublishCount = 0;
+    static unsigned long lastInvokeCount = 0;
+    Serial.printf("    publish: %.1f msg/s, invoke: %.1f call/s\n",
+                  (publishCount - lastPublishCount) * 1000.0 / REPORT_INTERVAL_MS,
+                  (invokeCount - lastInvokeCount) * 1000.0 / REPORT_INTERVAL_MS);
+    lastPublishCount = publishCount;
+    lastInvokeCount = invokeCount;
+
+    uint32_t messages = 0;
+    uint64_t bytes = 0;
+    for (int i = 0; i < FLEET_SIZE; i++) {
+        messages += fleet[i]->txMessages();
+        bytes += fleet[i]->txBytes();
+    }
+    if (messages > 0) {
+        Serial.printf("    wire (%s topics): %.1f bytes/msg over %lu msgs\n",
+                      COMPACT_TOPICS ? "compact" : "full",
+                      (double)bytes / messages, (unsigned long)messages);
+    }
+
+    if (invokeLatencyFilled > 0) {
+        std::vector<unsigned long> lat(invokeLatencyUs, invokeLatencyUs + invokeLatencyFilled);
+        std::sort(lat.begin(), lat.end());
+        Serial.printf("    invoke on device (receive -> response sent): p50 %lu us, p90 %lu us, p99 %lu us\n",
+                      percentile(lat, 50), percentile(lat, 90), percentile(lat, 99));
+    }
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(2000);
+
+    for (int i = 0; i < FLEET_SIZE; i++) {
+        setupVirtualDevice(i);
+    }
+    fleetStart = millis();
+}
+
+void loop() {
+    // At most one registration per pass so registered devices keep being serviced
+    if (registeredCount < FLEET_SIZE) {
+        registerNext();
+    }
+
+    unsigned long now = millis();
+    for (int i = 0; i < FLEET_SIZE; i++) {
+        if (!registered[i]) continue;
+        fleet[i]->loop();
+
+        if ((long)(now - nextPublish[i]) >= 0) {
+            nextPublish[i] += PUBLISH_INTERVAL_MS;
+            MeoEventPayload p;
+            p["temperature"] = String(random(200, 300) / 10);
+            p["humidity"] = String(random(400, 600) / 10);
+            if (fleet[i]->publishEvent("humid_temp_update", p)) {
+                publishCount++;
+            }
+        }
+    }
+
+    static unsigned long lastReport = 0;
+    if (now - lastReport >= REPORT_INTERVAL_MS) {
+        lastReport = now;
+        report();
+    }
+}
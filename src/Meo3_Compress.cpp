@@ -0,0 +1,157 @@
+#include "Meo3_Compress.h"
+
+MeoLzssEncoder::MeoLzssEncoder()
+    : _ring(nullptr),
+      _ringSize(0),
+      _windowSize(0),
+      _maxMatch(0),
+      _windowBits(0),
+      _lengthBits(0),
+      _pos(0),
+      _end(0),
+      _groupItems(0),
+      _groupLen(1),
+      _sink(nullptr),
+      _ok(false),
+      _bytesIn(0),
+      _bytesOut(0) {}
+
+MeoLzssEncoder::~MeoLzssEncoder() {
+    delete[] _ring;
+}
+
+bool MeoLzssEncoder::begin(uint8_t windowBits, MeoByteSink sink) {
+    if (windowBits < MEO_LZSS_MIN_WINDOW_BITS || windowBits > MEO_LZSS_MAX_WINDOW_BITS || !sink) {
+        return false;
+    }
+
+    _windowBits = windowBits;
+    _lengthBits = 16 - windowBits;
+    _windowSize = (size_t)1 << windowBits;
+    _maxMatch   = MEO_LZSS_MIN_MATCH + ((size_t)1 << _lengthBits) - 1;
+
+    // History window plus lookahead: writing at _end never clobbers bytes
+    // still reachable from _pos.
+    delete[] _ring;
+    _ringSize = _windowSize + _maxMatch;
+    _ring = new (std::nothrow) uint8_t[_ringSize];
+    if (!_ring) {
+        return false;
+    }
+
+    _pos = 0;
+    _end = 0;
+    _group[0] = 0;
+    _groupItems = 0;
+    _groupLen = 1;
+    _sink = sink;
+    _ok = true;
+    _bytesIn = 0;
+    _bytesOut = 0;
+    return true;
+}
+
+bool MeoLzssEncoder::write(const uint8_t* data, size_t len) {
+    if (!_ring) return false;
+
+    for (size_t i = 0; i < len && _ok; i++) {
+        // Only encode with a full lookahead so matches are never cut short
+        if (_end - _pos == _maxMatch) {
+            _encodeStep();
+        }
+        _ring[_end % _ringSize] = data[i];
+        _end++;
+    }
+    _bytesIn += len;
+    return _ok;
+}
+
+bool MeoLzssEncoder::finish() {
+    if (!_ring) return false;
+
+    while (_ok && _pos < _end) {
+        _encodeStep();
+    }
+    if (_ok && _groupItems > 0) {
+        _flushGroup();
+    }
+
+    delete[] _ring;
+    _ring = nullptr;
+    return _ok;
+}
+
+void MeoLzssEncoder::_encodeStep() {
+    uint32_t avail = _end - _pos;
+    uint32_t maxLen = avail < _maxMatch ? avail : _maxMatch;
+    uint32_t history = _pos < _windowSize ? _pos : _windowSize;
+
+    uint32_t bestLen = 0;
+    uint32_t bestOffset = 0;
+    if (maxLen >= MEO_LZSS_MIN_MATCH) {
+        uint8_t first = _at(_pos);
+        for (uint32_t offset = 1; offset <= history; offset++) {
+            uint32_t from = _pos - offset;
+            if (_at(from) != first) continue;
+
+            // Overlapping matches are fine: the decoder copies byte by byte
+            uint32_t len = 1;
+            while (len < maxLen && _at(from + len) == _at(_pos + len)) {
+                len++;
+            }
+            if (len > bestLen) {
+                bestLen = len;
+                bestOffset = offset;
+                if (len == maxLen) break;
+            }
+        }
+    }
+
+    if (bestLen >= MEO_LZSS_MIN_MATCH) {
+        _emitMatch(bestOffset, bestLen);
+        _pos += bestLen;
+    } else {
+        _emitLiteral(_at(_pos));
+        _pos++;
+    }
+}
+
+void MeoLzssEncoder::_emitLiteral(uint8_t b) {
+    _group[0] |= (uint8_t)(1 << _groupItems);
+    _group[_groupLen++] = b;
+    _itemDone();
+}
+
+void MeoLzssEncoder::_emitMatch(uint32_t offset, uint32_t length) {
+    uint16_t token = (uint16_t)(((offset - 1) << _lengthBits) | (length - MEO_LZSS_MIN_MATCH));
+    _group[_groupLen++] = (uint8_t)(token >> 8);
+    _group[_groupLen++] = (uint8_t)(token & 0xFF);
+    _itemDone();
+}
+
+void MeoLzssEncoder::_itemDone() {
+    if (++_groupItems == 8) {
+        _flushGroup();
+    }
+}
+
+void MeoLzssEncoder::_flushGroup() {
+    if (_ok && !_sink(_group, _groupLen)) {
+        _ok = false;
+    }
+    _bytesOut += _groupLen;
+    _group[0] = 0;
+    _groupItems = 0;
+    _groupLen = 1;
+}
+
+uint32_t meoCrc32(const uint8_t* data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <new>
+
+// Receives compressed bytes as they are produced; return false to abort.
+using MeoByteSink = std::function<bool(const uint8_t* data, size_t len)>;
+
+// Small-footprint streaming LZSS encoder used by the bulk upload channel.
+//
+// Stream format (decoder needs only windowBits):
+//   - items are grouped by 8, each group starts with a flag byte (LSB first)
+//   - flag bit 1: literal, one raw byte follows
+//   - flag bit 0: back-reference, two bytes follow (big endian):
+//       ((offset - 1) << (16 - windowBits)) | (length - MEO_LZSS_MIN_MATCH)
+//   - the last group may hold fewer than 8 items; the stream simply ends
+//
+// RAM use is (1 << windowBits) + max match length bytes, allocated in begin().
+static const uint8_t MEO_LZSS_MIN_MATCH      = 3;
+static const uint8_t MEO_LZSS_MIN_WINDOW_BITS = 8;   // 256 B window
+static const uint8_t MEO_LZSS_MAX_WINDOW_BITS = 12;  // 4 KB window
+
+class MeoLzssEncoder {
+public:
+    MeoLzssEncoder();
+    ~MeoLzssEncoder();
+
+    bool begin(uint8_t windowBits, MeoByteSink sink);
+    bool write(const uint8_t* data, size_t len);
+    bool finish();   // flush pending input and release the window buffer
+
+    uint8_t windowBits() const { return _windowBits; }
+    size_t  bytesIn() const { return _bytesIn; }
+    size_t  bytesOut() const { return _bytesOut; }
+
+private:
+    uint8_t*    _ring;
+    size_t      _ringSize;
+    size_t      _windowSize;
+    size_t      _maxMatch;
+    uint8_t     _windowBits;
+    uint8_t     _lengthBits;
+
+    uint32_t    _pos;   // absolute index of next byte to encode
+    uint32_t    _end;   // absolute index one past the last byte written
+
+    uint8_t     _group[1 + 8 * 2];
+    uint8_t     _groupItems;
+    uint8_t     _groupLen;
+
+    MeoByteSink _sink;
+    bool        _ok;
+    size_t      _bytesIn;
+    size_t      _bytesOut;
+
+    uint8_t _at(uint32_t absIndex) const { return _ring[absIndex % _ringSize]; }
+    void _encodeStep();
+    void _emitLiteral(uint8_t b);
+    void _emitMatch(uint32_t offset, uint32_t length);
+    void _itemDone();
+    void _flushGroup();
+};
+
+// CRC-32 (IEEE 802.3), chainable: pass the previous result as crc
+uint32_t meoCrc32(const uint8_t* data, size_t len, uint32_t crc = 0);
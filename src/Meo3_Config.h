@@ -0,0 +1,189 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Memory budget of the protocol buffers. Every value can be overridden from
+// the build, e.g. in platformio.ini:
+//
+//   build_flags =
+//       -D MEO_EVENT_BUFFER_SIZE=256
+//       -D MEO_INVOKE_BUFFER_SIZE=256
+//       -D MEO_MQTT_BUFFER_SIZE=384
+//
+// JSON capacities are ArduinoJson pool sizes; *_BUFFER_SIZE are serialized bytes.
+
+#ifndef MEO_EVENT_JSON_CAPACITY
+#define MEO_EVENT_JSON_CAPACITY 512          // publishEvent document
+#endif
+#ifndef MEO_EVENT_BUFFER_SIZE
+#define MEO_EVENT_BUFFER_SIZE 512            // serialized event
+#endif
+#ifndef MEO_RESPONSE_JSON_CAPACITY
+#define MEO_RESPONSE_JSON_CAPACITY 512       // feature_response document
+#endif
+#ifndef MEO_RESPONSE_BUFFER_SIZE
+#define MEO_RESPONSE_BUFFER_SIZE 512
+#endif
+#ifndef MEO_INVOKE_JSON_CAPACITY
+#define MEO_INVOKE_JSON_CAPACITY 512         // incoming feature invoke document
+#endif
+#ifndef MEO_INVOKE_BUFFER_SIZE
+#define MEO_INVOKE_BUFFER_SIZE 512           // largest invoke payload accepted
+#endif
+#ifndef MEO_STATUS_BUFFER_SIZE
+#define MEO_STATUS_BUFFER_SIZE 256           // OTA status and bulk manifest (doc and text)
+#endif
+#ifndef MEO_DELTA_PAGE_SIZE
+#define MEO_DELTA_PAGE_SIZE 512              // one feature_delta page
+#endif
+#ifndef MEO_DISCOVERY_DATAGRAM_SIZE
+#define MEO_DISCOVERY_DATAGRAM_SIZE 1024     // one discovery page
+#endif
+#ifndef MEO_REGISTRATION_JSON_CAPACITY
+#define MEO_REGISTRATION_JSON_CAPACITY 384   // registration response document
+#endif
+#ifndef MEO_MQTT_BUFFER_SIZE
+#define MEO_MQTT_BUFFER_SIZE 640             // PubSubClient packet buffer (grown on demand)
+#endif
+#ifndef MEO_MAX_DEVICE_ID_LEN
+#define MEO_MAX_DEVICE_ID_LEN 36             // longest device id the gateway assigns (UUID)
+#endif
+#ifndef MEO_MAX_FEATURE_NAME_LEN
+#define MEO_MAX_FEATURE_NAME_LEN 32          // longest method name with a full-size invoke
+#endif
+#ifndef MEO_MAX_TOPIC_LEVEL_LEN
+#define MEO_MAX_TOPIC_LEVEL_LEN 64           // request ids and bulk stream names used as topic levels
+#endif
+#ifndef MEO_RECENT_REQUEST_IDS
+#define MEO_RECENT_REQUEST_IDS 8             // duplicate-invoke filter depth
+#endif
+#ifndef MEO_MAX_TIMERS
+#define MEO_MAX_TIMERS 16                    // timer wheel pool (user and library timers)
+#endif
+#ifndef MEO_TIMER_TICK_MS
+#define MEO_TIMER_TICK_MS 10                 // timer resolution; co-due timers fire together
+#endif
+#ifndef MEO_STATE_FLUSH_MS
+#define MEO_STATE_FLUSH_MS 200               // setState() changes within this window share one diff
+#endif
+#ifndef MEO_LOCAL_SENDERS
+#define MEO_LOCAL_SENDERS 4                  // local-control senders with their own replay window
+#endif
+#ifndef MEO_LOCAL_REPLAY_WINDOW
+#define MEO_LOCAL_REPLAY_WINDOW 16           // seq values remembered per local-control sender
+#endif
+#ifndef MEO_TLS_SESSION_MAX
+#define MEO_TLS_SESSION_MAX 2048             // serialized TLS session incl. peer cert
+#endif
+
+// Compile-time view of the budget, used by the library code instead of literals
+struct MeoConfig {
+    static constexpr size_t  EVENT_JSON_CAPACITY        = MEO_EVENT_JSON_CAPACITY;
+    static constexpr size_t  EVENT_BUFFER_SIZE          = MEO_EVENT_BUFFER_SIZE;
+    static constexpr size_t  RESPONSE_JSON_CAPACITY     = MEO_RESPONSE_JSON_CAPACITY;
+    static constexpr size_t  RESPONSE_BUFFER_SIZE       = MEO_RESPONSE_BUFFER_SIZE;
+    static constexpr size_t  INVOKE_JSON_CAPACITY       = MEO_INVOKE_JSON_CAPACITY;
+    static constexpr size_t  INVOKE_BUFFER_SIZE         = MEO_INVOKE_BUFFER_SIZE;
+    static constexpr size_t  STATUS_BUFFER_SIZE         = MEO_STATUS_BUFFER_SIZE;
+    static constexpr size_t  DELTA_PAGE_SIZE            = MEO_DELTA_PAGE_SIZE;
+    static constexpr size_t  DISCOVERY_DATAGRAM_SIZE    = MEO_DISCOVERY_DATAGRAM_SIZE;
+    static constexpr size_t  REGISTRATION_JSON_CAPACITY = MEO_REGISTRATION_JSON_CAPACITY;
+    static constexpr size_t  MQTT_BUFFER_SIZE           = MEO_MQTT_BUFFER_SIZE;
+    static constexpr size_t  MAX_DEVICE_ID_LEN          = MEO_MAX_DEVICE_ID_LEN;
+    static constexpr size_t  MAX_FEATURE_NAME_LEN       = MEO_MAX_FEATURE_NAME_LEN;
+    static constexpr size_t  MAX_TOPIC_LEVEL_LEN        = MEO_MAX_TOPIC_LEVEL_LEN;
+    static constexpr uint8_t RECENT_REQUEST_IDS         = MEO_RECENT_REQUEST_IDS;
+    static constexpr uint8_t LOCAL_SENDERS              = MEO_LOCAL_SENDERS;
+    static constexpr uint8_t LOCAL_REPLAY_WINDOW        = MEO_LOCAL_REPLAY_WINDOW;
+    static constexpr size_t  TLS_SESSION_MAX            = MEO_TLS_SESSION_MAX;
+    static constexpr uint16_t MAX_TIMERS                = MEO_MAX_TIMERS;
+    static constexpr uint32_t TIMER_TICK_MS             = MEO_TIMER_TICK_MS;
+    static constexpr uint32_t STATE_FLUSH_MS            = MEO_STATE_FLUSH_MS;
+
+    static constexpr size_t maxOf(size_t a, size_t b) { return a > b ? a : b; }
+
+    static constexpr size_t LOCAL_MAC_LEN = 32;   // HMAC prefix of every local control datagram
+
+    // What a feature handler may put on the stack on top of the invoke frames:
+    // its response, an event, or an OTA status/bulk manifest (doc and text)
+    static constexpr size_t handlerStackBytes(size_t responseFrame) {
+        return maxOf(responseFrame, maxOf(EVENT_JSON_CAPACITY + EVENT_BUFFER_SIZE, 2 * STATUS_BUFFER_SIZE));
+    }
+
+    // Invoke over MQTT: payload copy -> parsed document -> handler
+    static constexpr size_t mqttInvokeStackBytes() {
+        return INVOKE_BUFFER_SIZE + INVOKE_JSON_CAPACITY +
+               handlerStackBytes(RESPONSE_JSON_CAPACITY + RESPONSE_BUFFER_SIZE);
+    }
+
+    // Invoke over local control: datagram -> parsed document -> handler, whose
+    // response builds its own signed datagram
+    static constexpr size_t localInvokeStackBytes() {
+        return LOCAL_MAC_LEN + INVOKE_BUFFER_SIZE + INVOKE_JSON_CAPACITY +
+               handlerStackBytes(RESPONSE_JSON_CAPACITY + LOCAL_MAC_LEN + RESPONSE_BUFFER_SIZE);
+    }
+
+    // Deepest chain of nested protocol buffers on the stack. Invokes nest
+    // (the handler runs inside the parse frames); everything else stands alone.
+    static constexpr size_t peakStackBytes() {
+        return maxOf(maxOf(mqttInvokeStackBytes(), localInvokeStackBytes()),
+                     maxOf(DELTA_PAGE_SIZE, DISCOVERY_DATAGRAM_SIZE + REGISTRATION_JSON_CAPACITY));
+    }
+
+    // A received PUBLISH in the PubSubClient buffer: fixed header (up to 5),
+    // topic length (2), "meo/{deviceId}/feature/{name}/invoke", packet id (2, QoS 1)
+    // and the payload
+    static constexpr size_t invokePacketBytes() {
+        return 5 + 2 + (4 + MAX_DEVICE_ID_LEN + 9 + MAX_FEATURE_NAME_LEN + 7) + 2 + INVOKE_BUFFER_SIZE;
+    }
+
+    // Header and topic of the longest PUBLISH carrying a caller-chosen level:
+    // "meo/{deviceId}/bulk/{stream}/{transferId}/{seq}" with 10-digit ids, which
+    // is longer than the compact response topic "meo/{deviceId}/r/{request_id}"
+    static constexpr size_t topicLevelPacketBytes() {
+        return 5 + 2 + (4 + MAX_DEVICE_ID_LEN + 6 + MAX_TOPIC_LEVEL_LEN + 1 + 10 + 1 + 10);
+    }
+
+    // Long-lived heap per MeoDevice: PubSubClient buffer (before any growth)
+    // plus the duplicate filter (Arduino String objects are ~16 bytes)
+    static constexpr size_t heapPerDevice() {
+        return MQTT_BUFFER_SIZE + RECENT_REQUEST_IDS * 16;
+    }
+};
+
+static_assert(MeoConfig::EVENT_JSON_CAPACITY >= 64 && MeoConfig::EVENT_BUFFER_SIZE >= 64,
+              "MEO_EVENT_*: too small for even a single field");
+static_assert(MeoConfig::RESPONSE_JSON_CAPACITY >= 128 && MeoConfig::RESPONSE_BUFFER_SIZE >= 128,
+              "MEO_RESPONSE_*: too small for the response header fields");
+static_assert(MeoConfig::INVOKE_JSON_CAPACITY >= 64 && MeoConfig::INVOKE_BUFFER_SIZE >= 32,
+              "MEO_INVOKE_*: too small to parse an invoke");
+static_assert(MeoConfig::STATUS_BUFFER_SIZE >= 192,
+              "MEO_STATUS_BUFFER_SIZE: OTA status and bulk manifest need at least 192 bytes");
+static_assert(MeoConfig::DELTA_PAGE_SIZE >= 256,
+              "MEO_DELTA_PAGE_SIZE: must hold the page header plus at least one name");
+static_assert(MeoConfig::DISCOVERY_DATAGRAM_SIZE >= 384 && MeoConfig::DISCOVERY_DATAGRAM_SIZE <= 1472,
+              "MEO_DISCOVERY_DATAGRAM_SIZE: must hold the device header and fit one Ethernet frame");
+static_assert(MeoConfig::REGISTRATION_JSON_CAPACITY >= 128,
+              "MEO_REGISTRATION_JSON_CAPACITY: too small for device_id/transmit_key");
+static_assert(MeoConfig::MQTT_BUFFER_SIZE >= 128 && MeoConfig::MQTT_BUFFER_SIZE <= 0xFFFF,
+              "MEO_MQTT_BUFFER_SIZE: PubSubClient supports 128..65535 here");
+static_assert(MeoConfig::MQTT_BUFFER_SIZE >= MeoConfig::invokePacketBytes(),
+              "MEO_MQTT_BUFFER_SIZE: invokes up to MEO_INVOKE_BUFFER_SIZE could not be received "
+              "(packet header and topic included, see MEO_MAX_DEVICE_ID_LEN/MEO_MAX_FEATURE_NAME_LEN)");
+static_assert(MeoConfig::MAX_TOPIC_LEVEL_LEN >= 8,
+              "MEO_MAX_TOPIC_LEVEL_LEN: too short for a request id");
+static_assert(MeoConfig::topicLevelPacketBytes() <= MeoConfig::MQTT_BUFFER_SIZE,
+              "MEO_MAX_TOPIC_LEVEL_LEN: a bulk or compact response topic would not fit MEO_MQTT_BUFFER_SIZE");
+static_assert(MeoConfig::RECENT_REQUEST_IDS >= 1,
+              "MEO_RECENT_REQUEST_IDS: need at least one slot");
+static_assert(MeoConfig::LOCAL_SENDERS >= 1,
+              "MEO_LOCAL_SENDERS: need at least one replay window");
+static_assert(MeoConfig::LOCAL_REPLAY_WINDOW >= 1,
+              "MEO_LOCAL_REPLAY_WINDOW: need at least one slot");
+static_assert(MeoConfig::MAX_TIMERS >= 4 && MeoConfig::MAX_TIMERS < 0xFFFF,
+              "MEO_MAX_TIMERS: the library itself uses a few timers");
+static_assert(MeoConfig::TIMER_TICK_MS >= 1 && MeoConfig::TIMER_TICK_MS <= 1000,
+              "MEO_TIMER_TICK_MS: must be 1..1000");
+static_assert(MeoConfig::TLS_SESSION_MAX >= 256,
+              "MEO_TLS_SESSION_MAX: too small for a serialized TLS session");
@@ -1,15 +1,88 @@
 #include "Meo3_Device.h"
 #include <WiFi.h>
 
+static const uint32_t MEO_MQTT_RETRY_MS     = 1000;
+static const uint32_t MEO_LOOP_MAX_SLEEP_MS = 50;
+static const uint32_t MEO_SCHEMA_RESEND_MS  = 30000;    // doubled per unacknowledged delta
+static const uint32_t MEO_SCHEMA_RESEND_MAX_MS = 900000;
+
 MeoDevice::MeoDevice()
     : _registrationPort(8901),
       _mqttPort(1883),
+      _localControlPort(0),
       _logger(nullptr),
       _wifiReady(false),
       _registered(false),
-      _mqttReady(false) {}
+      _mqttReady(false),
+      _otaAutoReboot(true),
+      _schemaAnnounced(false),
+      _mqttRetryTimer(0),
+      _gatewayProbeTimer(0),
+      _stateFlushTimer(0),
+      _schemaResendTimer(0),
+      _schemaResendMs(MEO_SCHEMA_RESEND_MS) {
+    _mqtt.addReservedMethod("_time_sync", [this](const MeoFeatureCall& call) {
+        auto it = call.params.find("epoch_ms");
+        if (it == call.params.end()) {
+            sendFeatureResponse(call, false, "missing epoch_ms");
+            return;
+        }
+        syncTime(strtoull(it->second.c_str(), nullptr, 10));
+        sendFeatureResponse(call, true, nullptr);
+    });
+
+    _mqtt.addReservedMethod("_state_get", [this](const MeoFeatureCall& call) {
+        sendFeatureResponse(call, publishStateSnapshot(), nullptr);
+    });
+
+    _mqtt.addReservedMethod("_state_set", [this](const MeoFeatureCall& call) {
+        _state.applyDesired(call.params, _desiredStateCallback);
+        sendFeatureResponse(call, true, nullptr);
+        _flushState();   // report the applied values right away
+    });
+
+    _mqtt.addReservedMethod("_schema_ack", [this](const MeoFeatureCall& call) {
+        auto it = call.params.find("schema_hash");
+        if (it == call.params.end()) {
+            sendFeatureResponse(call, false, "missing schema_hash");
+            return;
+        }
+        // An ack for an older delta must not mark the current feature set as known
+        if ((uint32_t)strtoul(it->second.c_str(), nullptr, 10) != MeoRegistrationClient::schemaHash(_featureRegistry)) {
+            sendFeatureResponse(call, false, "stale schema_hash");
+            return;
+        }
+        if (!_schemaAnnounced) {
+            _saveSchema();
+            _log("INFO", "Feature delta acknowledged by gateway");
+        }
+        sendFeatureResponse(call, true, nullptr);
+    });
+
+    _mqtt.addReservedMethod("_gateways", [this](const MeoFeatureCall& call) {
+        auto it = call.params.find("endpoints");
+        if (it == call.params.end()) {
+            sendFeatureResponse(call, false, "missing endpoints");
+            return;
+        }
+        _learnGateways(it->second);
+        sendFeatureResponse(call, true, nullptr);
+    });
+
+    _mqtt.setLocalControl(&_local);
+    _local.setDispatcher([this](MeoFeatureCall& call) {
+        _mqtt.dispatchFeatureCall(call);
+    });
+}
 
 void MeoDevice::beginWifi(const char* ssid, const char* password) {
+    if (WiFi.status() == WL_CONNECTED) {
+        // Already connected (e.g. by another MeoDevice instance); just reuse the link
+        _wifiReady = true;
+        _storage.begin();
+        return;
+    }
+
     WiFi.mode(WIFI_STA);
     WiFi.begin(ssid, password);
 
@@ -38,9 +111,39 @@ void MeoDevice::setGateway(const char* host, uint16_t registrationPort, uint16_t
     _mqttPort = mqttPort;
 
     _registration.setGateway(host, registrationPort);
+    _gateways.setPrimary(host, mqttPort);
     _mqtt.configure(host, mqttPort, _deviceId, _transmitKey, &_featureRegistry);
 }
 
+void MeoDevice::addGateway(const char* host, uint16_t mqttPort) {
+    _gateways.add(host, mqttPort);
+}
+
+String MeoDevice::activeGateway() const {
+    const MeoGatewayEndpoint* gw = _gateways.active();
+    return gw ? gw->host + ":" + String(gw->mqttPort) : String("");
+}
+
+unsigned long MeoDevice::lastFailoverMs() const {
+    return _gateways.lastFailoverMs();
+}
+
+uint32_t MeoDevice::failoverCount() const {
+    return _gateways.failoverCount();
+}
+
+void MeoDevice::setRegistrationTcpFallback(bool enabled) {
+    _registration.setTcpFallback(enabled);
+}
+
+unsigned long MeoDevice::lastRegistrationMs() const {
+    return _registration.lastRegistrationMs();
+}
+
+uint8_t MeoDevice::lastRegistrationTransmissions() const {
+    return _registration.lastTransmissions();
+}
+
 void MeoDevice::begin(const char* host, uint16_t mqttPort) {
     setGateway(host, 8901, mqttPort);
 }
@@ -55,11 +158,22 @@ void MeoDevice::setDeviceInfo(const char* label,
     _deviceInfo.connectionType = connectionType;
 }
 
+void MeoDevice::setMacAddress(const char* mac) {
+    _registration.setMacAddress(mac);
+}
+
+void MeoDevice::setStorageNamespace(const char* ns) {
+    _storage.setNamespace(ns);
+}
+
 void MeoDevice::addFeatureEvent(const char* eventName) {
     _featureRegistry.eventNames.push_back(String(eventName));
 }
 
 void MeoDevice::addFeatureMethod(const char* methodName, MeoFeatureCallback callback) {
+    if (strlen(methodName) > MeoConfig::MAX_FEATURE_NAME_LEN) {
+        _log("WARN", "Method name longer than MEO_MAX_FEATURE_NAME_LEN: large invokes may not fit the MQTT buffer");
+    }
     _featureRegistry.methodHandlers[String(methodName)] = callback;
 }
 
@@ -80,28 +194,54 @@ bool MeoDevice::start() {
             return false;
         }
         _storage.saveCredentials(_deviceId, _transmitKey);
+        _saveSchema();   // the full registration announced every feature
+        _learnGateways(_registration.learnedGateways());
         _registered = true;
         _log("INFO", "Registered and saved credentials");
     }
 
+    String learned;
+    if (_storage.loadGateways(learned)) {
+        _gateways.addLearned(learned, _mqttPort, !_mqtt.isBrokerVerified());
+    }
+
     // Configure MQTT with final deviceId/transmitKey
     _mqtt.setLogger(_logger);
-    _mqtt.configure(_gatewayHost.c_str(), _mqttPort, _deviceId, _transmitKey, &_featureRegistry);
+    _configureMqtt();
+
+    if (_localControlPort != 0) {
+        _local.configure(_deviceId, _transmitKey, &_clock);
+        _local.begin(_localControlPort);
+    }
+
+    if (!_gatewayProbeTimer) {
+        _gatewayProbeTimer = _timers.every(_gateways.probeInterval(), [this]() { _probeGateways(); });
+    }
 
     if (!_mqtt.connect()) {
         _log("ERROR", "Failed to connect to MQTT");
         _mqttReady = false;
+        if (_gateways.reportConnectFailed()) {
+            _configureMqtt();   // the retry goes to the new gateway
+        }
+        _scheduleMqttRetry(MEO_MQTT_RETRY_MS);
         return false;
     }
 
     _mqttReady = true;
     _log("INFO", "MQTT connected");
+    _gateways.reportConnected();
+    _onMqttConnected();
     return true;
 }
 
-void MeoDevice::loop() {
+uint32_t MeoDevice::loop() {
+    // User and library timers first; they run even while the network is down
+    _timers.advance(millis());
+
     if (!_wifiReady) {
-        return;
+        uint32_t untilNext = _timers.msUntilNext();
+        return untilNext < MEO_MQTT_RETRY_MS ? untilNext : MEO_MQTT_RETRY_MS;
     }
 
     if (!_registered) {
@@ -109,17 +249,51 @@ void MeoDevice::loop() {
         start();
     }
 
-    if (_registered && !_mqttReady) {
-        // Try reconnect MQTT
-        if (_mqtt.connect()) {
-            _mqttReady = true;
-            _log("INFO", "MQTT reconnected");
-        }
+    _local.loop();   // independent of the broker connection
+
+    if (_registered && !_mqttReady && !_timers.isActive(_mqttRetryTimer)) {
+        _scheduleMqttRetry(0);
     }
 
     if (_mqttReady) {
         _mqtt.loop();
+        _scheduleStateFlush();
+        if (!_mqtt.isConnected()) {
+            _mqttReady = false;
+            _gateways.reportLost();
+            _log("WARN", "MQTT connection lost");
+            _scheduleMqttRetry(0);
+        }
     }
+
+    if (_otaAutoReboot && _mqtt.isOtaRebootPending()) {
+        _log("INFO", "OTA complete, rebooting into new firmware");
+        delay(500);   // let the final status and response go out
+        ESP.restart();
+    }
+
+    // Incoming packets are only noticed by polling, so keep the sleep short while
+    // online. Offline or unregistered, the next attempt may not be on the wheel
+    // (msUntilNext() can be NO_DEADLINE), so come back after the retry interval.
+    uint32_t untilNext = _timers.msUntilNext();
+    uint32_t maxSleep = (_mqttReady || _local.isListening()) ? MEO_LOOP_MAX_SLEEP_MS : MEO_MQTT_RETRY_MS;
+    return untilNext < maxSleep ? untilNext : maxSleep;
+}
+
+MeoTimerId MeoDevice::every(uint32_t periodMs, MeoTimerCallback callback) {
+    MeoTimerId id = _timers.every(periodMs, callback);
+    if (id == 0) _log("ERROR", "No free timer; raise MEO_MAX_TIMERS");
+    return id;
+}
+
+MeoTimerId MeoDevice::after(uint32_t delayMs, MeoTimerCallback callback) {
+    MeoTimerId id = _timers.after(delayMs, callback);
+    if (id == 0) _log("ERROR", "No free timer; raise MEO_MAX_TIMERS");
+    return id;
+}
+
+bool MeoDevice::cancelTimer(MeoTimerId id) {
+    return _timers.cancel(id);
 }
 
 bool MeoDevice::isRegistered() const {
@@ -130,15 +304,208 @@ bool MeoDevice::isMqttConnected() const {
     return _mqttReady && _mqtt.isConnected();
 }
 
+void MeoDevice::beginTimeSync(const char* ntpServer) {
+    _clock.beginSntp(ntpServer);
+}
+
+void MeoDevice::syncTime(uint64_t epochMs) {
+    _clock.syncTo(epochMs);
+    _log("INFO", "Clock synced from gateway");
+}
+
+bool MeoDevice::isTimeSynced() const {
+    return _clock.isSynced();
+}
+
+uint64_t MeoDevice::nowMs() const {
+    return _clock.nowMs();
+}
+
 bool MeoDevice::publishEvent(const char* eventName, const MeoEventPayload& payload) {
+    return publishEvent(eventName, payload, _clock.nowMs());
+}
+
+bool MeoDevice::publishEvent(const char* eventName, const MeoEventPayload& payload, uint64_t timestampMs) {
     if (!_mqttReady) {
         _log("WARN", "MQTT not ready, cannot publish event");
         return false;
     }
-    return _mqtt.publishEvent(eventName, payload);
+    return _mqtt.publishEvent(eventName, payload, timestampMs);
+}
+
+bool MeoDevice::publishTimeSeries(const char* eventName, const MeoTimeSeries& series) {
+    if (!_mqttReady) {
+        _log("WARN", "MQTT not ready, cannot publish time series");
+        return false;
+    }
+    return _mqtt.publishTimeSeries(eventName, series);
+}
+
+void MeoDevice::useTls(const char* caCertPem) {
+    _mqtt.useTls(caCertPem, &_storage);
+}
+
+unsigned long MeoDevice::lastTlsHandshakeMs() const {
+    return _mqtt.lastTlsHandshakeMs();
+}
+
+void MeoDevice::setPersistentSession(bool enabled) {
+    _mqtt.setPersistentSession(enabled);
+}
+
+unsigned long MeoDevice::lastMqttReconnectMs() const {
+    return _mqtt.lastReconnectMs();
+}
+
+bool MeoDevice::setState(const char* key, const String& value) {
+    return _state.set(String(key), value);
+}
+
+bool MeoDevice::setState(const char* key, const char* value) {
+    return _state.set(String(key), String(value));
+}
+
+String MeoDevice::getState(const char* key) const {
+    return _state.get(String(key));
+}
+
+void MeoDevice::onDesiredState(MeoStateCallback callback) {
+    _desiredStateCallback = callback;
+}
+
+bool MeoDevice::publishStateSnapshot() {
+    if (!_mqttReady) {
+        return false;
+    }
+    if (!_mqtt.publishState(_state, true)) {
+        return false;
+    }
+    _state.markPublished();
+    return true;
+}
+
+void MeoDevice::_onMqttConnected() {
+    _announceFeatureChanges();
+
+    // The gateway may have missed diffs while we were away
+    if (_state.version() > 0) {
+        publishStateSnapshot();
+    }
+}
+
+void MeoDevice::_saveSchema() {
+    _storage.saveSchema(MeoRegistrationClient::schemaHash(_featureRegistry),
+                        MeoRegistrationClient::joinEventNames(_featureRegistry),
+                        MeoRegistrationClient::joinMethodNames(_featureRegistry));
+    _schemaAnnounced = true;
+    _timers.cancel(_schemaResendTimer);
+    _schemaResendTimer = 0;
+}
+
+void MeoDevice::_announceFeatureChanges() {
+    if (_schemaAnnounced) {
+        return;
+    }
+
+    // A firmware update may have added or removed features since registration
+    uint32_t storedHash = 0;
+    String storedEvents;
+    String storedMethods;
+    bool haveStored = _storage.loadSchema(storedHash, storedEvents, storedMethods);
+    if (haveStored && storedHash == MeoRegistrationClient::schemaHash(_featureRegistry)) {
+        _schemaAnnounced = true;
+        return;
+    }
+
+    MeoFeatureDelta delta = MeoRegistrationClient::computeDelta(_featureRegistry, haveStored,
+                                                                storedEvents, storedMethods);
+    if (!_mqtt.publishFeatureDelta(delta)) {
+        return;   // the next connect tries again
+    }
+
+    // QoS 0: the schema is stored only once the gateway answers with "_schema_ack".
+    // Until then the delta is resent, and again after every reconnect.
+    if (!_timers.isActive(_schemaResendTimer)) {
+        _schemaResendTimer = _timers.after(_schemaResendMs, [this]() {
+            _schemaResendTimer = 0;
+            if (_mqttReady) {
+                _announceFeatureChanges();
+            }
+        });
+        _schemaResendMs = _schemaResendMs * 2 < MEO_SCHEMA_RESEND_MAX_MS ? _schemaResendMs * 2
+                                                                        : MEO_SCHEMA_RESEND_MAX_MS;
+    }
+}
+
+void MeoDevice::_scheduleStateFlush() {
+    // The first change opens a window; everything set until it closes goes out as one diff
+    if (!_state.hasPendingChanges() || _timers.isActive(_stateFlushTimer)) {
+        return;
+    }
+    _stateFlushTimer = _timers.after(MeoConfig::STATE_FLUSH_MS, [this]() {
+        _stateFlushTimer = 0;
+        _flushState();
+    });
+}
+
+void MeoDevice::_flushState() {
+    if (!_mqttReady || !_state.hasPendingChanges()) {
+        return;
+    }
+    if (_mqtt.publishState(_state, false)) {
+        _state.markPublished();
+    }
+}
+
+bool MeoDevice::publishBulk(const char* streamName, const uint8_t* data, size_t len,
+                            size_t chunkSize, uint8_t windowBits) {
+    if (!_mqttReady) {
+        _log("WARN", "MQTT not ready, cannot publish bulk data");
+        return false;
+    }
+    return _mqtt.publishBulk(streamName, data, len, chunkSize, windowBits);
+}
+
+bool MeoDevice::beginBulk(const char* streamName, size_t chunkSize, uint8_t windowBits) {
+    if (!_mqttReady) {
+        _log("WARN", "MQTT not ready, cannot publish bulk data");
+        return false;
+    }
+    return _mqtt.beginBulk(streamName, chunkSize, windowBits);
+}
+
+bool MeoDevice::writeBulk(const uint8_t* data, size_t len) {
+    return _mqtt.writeBulk(data, len);
+}
+
+bool MeoDevice::endBulk() {
+    return _mqtt.endBulk();
+}
+
+void MeoDevice::enableOta() {
+    _mqtt.enableOta();
+}
+
+void MeoDevice::setOtaSink(MeoOtaSink* sink) {
+    _mqtt.setOtaSink(sink);
+}
+
+void MeoDevice::setOtaAutoReboot(bool enabled) {
+    _otaAutoReboot = enabled;
+}
+
+void MeoDevice::setOtaPublicKey(const char* publicKeyPem) {
+    _mqtt.setOtaPublicKey(publicKeyPem);
+}
+
+void MeoDevice::setOtaAllowUnsigned(bool allow) {
+    _mqtt.setOtaAllowUnsigned(allow);
 }
 
 bool MeoDevice::sendFeatureResponse(const MeoFeatureCall& call, bool success, const char* message) {
+    if (call.origin == MeoCallOrigin::LOCAL_UDP) {
+        return _local.sendResponse(call, success, message);
+    }
     if (!_mqttReady) {
         _log("WARN", "MQTT not ready, cannot send feature response");
         return false;
@@ -146,10 +513,134 @@ bool MeoDevice::sendFeatureResponse(const MeoFeatureCall& call, bool success, co
     return _mqtt.sendFeatureResponse(call, success, message);
 }
 
+void MeoDevice::setCompactTopics(bool enabled) {
+    _mqtt.setCompactTopics(enabled);
+}
+
+uint32_t MeoDevice::txMessages() const {
+    return _mqtt.txMessages();
+}
+
+uint64_t MeoDevice::txBytes() const {
+    return _mqtt.txBytes();
+}
+
+void MeoDevice::enableLocalControl(uint16_t port) {
+    _localControlPort = port;
+}
+
+void MeoDevice::setTracing(bool enabled) {
+    _mqtt.setTracing(enabled);
+    _local.setTracing(enabled);
+}
+
+const MeoInvokeStats& MeoDevice::invokeStats(MeoCallOrigin origin) const {
+    return origin == MeoCallOrigin::LOCAL_UDP ? _local.invokeStats() : _mqtt.invokeStats();
+}
+
+void MeoDevice::logInvokeStats() {
+    const MeoInvokeStats* paths[] = {&_mqtt.invokeStats(), &_local.invokeStats()};
+    const char* pathNames[] = {"mqtt", "local"};
+    const char* names[] = {"parse", "handler", "publish", "total"};
+
+    for (int p = 0; p < 2; p++) {
+        const MeoInvokeStats& stats = *paths[p];
+        if (p > 0 && stats.total.count() == 0) {
+            continue;   // local control unused
+        }
+        const MeoLatencyHistogram* stages[] = {&stats.parse, &stats.handler, &stats.publish, &stats.total};
+        for (int i = 0; i < 4; i++) {
+            const MeoLatencyHistogram& h = *stages[i];
+            String msg = "Invoke " + String(pathNames[p]) + " " + String(names[i]) + ": n=" + String(h.count()) +
+                         " p50<=" + String(h.percentileUs(50)) + "us" +
+                         " p90<=" + String(h.percentileUs(90)) + "us" +
+                         " p99<=" + String(h.percentileUs(99)) + "us" +
+                         " max=" + String(h.maxUs()) + "us";
+            _log("INFO", msg.c_str());
+        }
+    }
+}
+
+void MeoDevice::logMemoryBudget() {
+    String msg = "Memory budget: event " + String((unsigned long)MeoConfig::EVENT_JSON_CAPACITY) + "+" +
+                 String((unsigned long)MeoConfig::EVENT_BUFFER_SIZE) +
+                 " B, response " + String((unsigned long)MeoConfig::RESPONSE_JSON_CAPACITY) + "+" +
+                 String((unsigned long)MeoConfig::RESPONSE_BUFFER_SIZE) +
+                 " B, invoke " + String((unsigned long)MeoConfig::INVOKE_JSON_CAPACITY) + "+" +
+                 String((unsigned long)MeoConfig::INVOKE_BUFFER_SIZE) +
+                 " B, discovery page " + String((unsigned long)MeoConfig::DISCOVERY_DATAGRAM_SIZE) +
+                 " B, mqtt buffer " + String((unsigned long)MeoConfig::MQTT_BUFFER_SIZE) +
+                 " B, duplicate filter " + String((unsigned)MeoConfig::RECENT_REQUEST_IDS);
+    _log("INFO", msg.c_str());
+
+    msg = "Memory budget: peak protocol stack " + String((unsigned long)MeoConfig::peakStackBytes()) +
+          " B, heap per device " + String((unsigned long)MeoConfig::heapPerDevice()) +
+          " B, sizeof(MeoDevice) " + String((unsigned long)sizeof(MeoDevice)) + " B";
+    _log("INFO", msg.c_str());
+}
+
 void MeoDevice::setLogger(MeoLogFunction logger) {
     _logger = logger;
     _registration.setLogger(logger);
     _mqtt.setLogger(logger);
+    _local.setLogger(logger);
+    _gateways.setLogger(logger);
+}
+
+void MeoDevice::_scheduleMqttRetry(uint32_t delayMs) {
+    if (_timers.isActive(_mqttRetryTimer)) {
+        return;
+    }
+    _mqttRetryTimer = _timers.after(delayMs, [this]() { _retryMqtt(); });
+}
+
+void MeoDevice::_retryMqtt() {
+    _mqttRetryTimer = 0;
+    if (_mqttReady || !_registered) {
+        return;
+    }
+
+    if (_mqtt.connect()) {
+        _mqttReady = true;
+        _log("INFO", "MQTT reconnected");
+        _gateways.reportConnected();
+        _onMqttConnected();
+        return;
+    }
+
+    // Repeated failures move on to another gateway
+    if (_gateways.reportConnectFailed()) {
+        _configureMqtt();
+    }
+    _scheduleMqttRetry(MEO_MQTT_RETRY_MS);
+}
+
+void MeoDevice::_probeGateways() {
+    if (_mqttReady && _gateways.probeNext(_mqtt.isConnected())) {
+        // a clearly better gateway passed enough probes: move over
+        _mqtt.disconnect();
+        _mqttReady = false;
+        _configureMqtt();
+        _scheduleMqttRetry(0);
+    }
+}
+
+void MeoDevice::_configureMqtt() {
+    const MeoGatewayEndpoint* gw = _gateways.active();
+    if (gw) {
+        _mqtt.configure(gw->host.c_str(), gw->mqttPort, _deviceId, _transmitKey, &_featureRegistry);
+    } else {
+        _mqtt.configure(_gatewayHost.c_str(), _mqttPort, _deviceId, _transmitKey, &_featureRegistry);
+    }
+}
+
+void MeoDevice::_learnGateways(const String& list) {
+    // Without a verified broker anyone on the path can send "_gateways", and the
+    // device would hand its transmit key to wherever it points: stay on the LAN
+    bool localSubnetOnly = !_mqtt.isBrokerVerified();
+    if (list.length() > 0 && _gateways.addLearned(list, _mqttPort, localSubnetOnly) > 0) {
+        _storage.saveGateways(_gateways.learnedList());
+    }
 }
 
 void MeoDevice::_log(const char* level, const char* msg) {
@@ -5,6 +5,9 @@
 #include "Meo3_Registration.h"
 #include "Meo3_Mqtt.h"
 #include "Meo3_Storage.h"
+#include "Meo3_Time.h"
+#include "Meo3_Gateway.h"
+#include "Meo3_Timer.h"
 
 class MeoDevice {
 public:
@@ -17,11 +20,32 @@ public:
     // Convenience: set gateway + start
     void begin(const char* host, uint16_t mqttPort = 1883);
 
+    // --- Redundant gateways ---
+    // Further gateways of the same site (same credentials). Gateways are also
+    // learned at registration and through the reserved "_gateways" method.
+    // See MeoGatewaySelector for the fail-over and fail-back rules.
+    void addGateway(const char* host, uint16_t mqttPort = 1883);
+    String activeGateway() const;            // "host:port"
+    unsigned long lastFailoverMs() const;    // loss of connection -> connected to another gateway
+    uint32_t failoverCount() const;
+
+    // --- Registration ---
+    // Old gateways answer discovery over TCP 8091 instead of UDP; disable to
+    // skip that listener (registration then gives up after 6.3 s).
+    void setRegistrationTcpFallback(bool enabled);
+    unsigned long lastRegistrationMs() const;    // discovery sent -> credentials received
+    uint8_t lastRegistrationTransmissions() const;
+
     void setDeviceInfo(const char* label,
                        const char* model,
                        const char* manufacturer,
                        MeoConnectionType connectionType = MeoConnectionType::LAN);
 
+    // --- Multi-instance support (e.g. fleet simulation) ---
+    // Call before start(); each instance needs its own identity and storage.
+    void setMacAddress(const char* mac);
+    void setStorageNamespace(const char* ns);
+
     // --- Feature and event model configuration ---
     void addFeatureEvent(const char* eventName);
     void addFeatureMethod(const char* methodName, MeoFeatureCallback callback);
@@ -29,17 +53,95 @@ public:
     // --- Lifecycle ---
     // Trigger registration (if no device_id/transmit_key) and then connect MQTT
     bool start();
-    void loop();   // must be called often from Arduino loop()
+    // Must be called often from Arduino loop(). Returns the ms until the next
+    // timer is due, capped at 50 ms while online (so invokes are not delayed)
+    // and at the 1 s retry interval otherwise; the caller may sleep that long.
+    uint32_t loop();
+
+    // --- Timers (hierarchical timer wheel, MEO_TIMER_TICK_MS resolution) ---
+    // Periodic timers are aligned to multiples of their period, so e.g. a 1 s
+    // and a 5 s timer fire in the same tick. Callbacks run from loop().
+    MeoTimerId every(uint32_t periodMs, MeoTimerCallback callback);
+    MeoTimerId after(uint32_t delayMs, MeoTimerCallback callback);
+    bool cancelTimer(MeoTimerId id);
 
     bool isRegistered() const;
     bool isMqttConnected() const;
 
+    // MQTT over TLS; call before start() and pass the TLS port to begin()/setGateway().
+    // nullptr CA skips broker verification (local testing only).
+    void useTls(const char* caCertPem = nullptr);
+    unsigned long lastTlsHandshakeMs() const;
+
+    // Low-latency path: accept signed invocations directly from the gateway over
+    // UDP (see MeoLocalControl); responses go back the same way. MQTT keeps
+    // working in parallel and remains the fallback. Call before start().
+    void enableLocalControl(uint16_t port = 8902);
+
+    // Shorter event/response topics (see MeoMqttClient::setCompactTopics); the
+    // gateway must understand them. Traffic counters cover both modes.
+    void setCompactTopics(bool enabled);
+    uint32_t txMessages() const;
+    uint64_t txBytes() const;
+
+    // Keep the broker session across reconnects (see MeoMqttClient::setPersistentSession)
+    void setPersistentSession(bool enabled);
+    unsigned long lastMqttReconnectMs() const;
+
+    // --- Time ---
+    // Events carry a "ts" (Unix epoch ms) once the clock is synced, either by
+    // SNTP or by the gateway through the reserved "_time_sync" method.
+    void beginTimeSync(const char* ntpServer = "pool.ntp.org");
+    void syncTime(uint64_t epochMs);
+    bool isTimeSynced() const;
+    uint64_t nowMs() const;   // 0 while not synced
+
     // --- Event publishing ---
     bool publishEvent(const char* eventName, const MeoEventPayload& payload);
+    // For buffered data: stamp with the time the sample was taken
+    bool publishEvent(const char* eventName, const MeoEventPayload& payload, uint64_t timestampMs);
+    // Many samples of one field in a single delta-encoded message
+    bool publishTimeSeries(const char* eventName, const MeoTimeSeries& series);
+
+    // --- Device state shadow ---
+    // Changed fields are published as a versioned diff from loop(); a full
+    // snapshot goes out on every MQTT (re)connect and when the gateway invokes
+    // the reserved "_state_get" method. Desired values arrive through "_state_set".
+    bool setState(const char* key, const String& value);
+    bool setState(const char* key, const char* value);
+    String getState(const char* key) const;
+    void onDesiredState(MeoStateCallback callback);
+    bool publishStateSnapshot();
+
+    // --- Bulk upload (compressed, chunked; for buffered or diagnostic data) ---
+    bool publishBulk(const char* streamName, const uint8_t* data, size_t len,
+                     size_t chunkSize = 256, uint8_t windowBits = 10);
+    bool beginBulk(const char* streamName, size_t chunkSize = 256, uint8_t windowBits = 10);
+    bool writeBulk(const uint8_t* data, size_t len);
+    bool endBulk();
+
+    // --- OTA firmware updates over MQTT (see MeoMqttClient) ---
+    void enableOta();                           // off by default: "_ota" is not answered
+    void setOtaSink(MeoOtaSink* sink);          // default: inactive OTA partition; enables OTA
+    void setOtaAutoReboot(bool enabled);        // reboot into new image once committed (default on)
+    // Accept only images signed with the matching private key (PEM, not copied).
+    void setOtaPublicKey(const char* publicKeyPem);
+    // Without a key, images are refused unless this is set; then anyone who can
+    // invoke "_ota" can flash arbitrary firmware. Development only.
+    void setOtaAllowUnsigned(bool allow);
 
     // --- Feature responses ---
     bool sendFeatureResponse(const MeoFeatureCall& call, bool success, const char* message = nullptr);
 
+    // --- Invoke latency tracing (see MeoMqttClient::setTracing) ---
+    void setTracing(bool enabled);
+    // Stats are kept per transport: MQTT and local control (UDP) calls differ too much to share a histogram
+    const MeoInvokeStats& invokeStats(MeoCallOrigin origin = MeoCallOrigin::MQTT) const;
+    void logInvokeStats();
+
+    // Prints the compile-time buffer budget (see Meo3_Config.h)
+    void logMemoryBudget();
+
     // --- Debug / logging hooks (optional) ---
     void setLogger(MeoLogFunction logger);
 
@@ -48,6 +150,7 @@ private:
     String       _gatewayHost;
     uint16_t     _registrationPort;
     uint16_t     _mqttPort;
+    uint16_t     _localControlPort;   // 0 = disabled
 
     String       _deviceId;
     String       _transmitKey;
@@ -56,12 +159,35 @@ private:
     MeoFeatureRegistry     _featureRegistry;
     MeoRegistrationClient  _registration;
     MeoMqttClient          _mqtt;
+    MeoLocalControl        _local;
+    MeoGatewaySelector     _gateways;
+    MeoTimerWheel          _timers;
     MeoStorage             _storage;
+    MeoClock               _clock;
+    MeoStateDocument       _state;
+    MeoStateCallback       _desiredStateCallback;
     MeoLogFunction         _logger;
 
     bool _wifiReady;
     bool _registered;
     bool _mqttReady;
-
+    bool _otaAutoReboot;
+    bool _schemaAnnounced;
+    MeoTimerId _mqttRetryTimer;
+    MeoTimerId _gatewayProbeTimer;
+    MeoTimerId _stateFlushTimer;
+    MeoTimerId _schemaResendTimer;
+    uint32_t   _schemaResendMs;
+
+    void _scheduleMqttRetry(uint32_t delayMs);
+    void _retryMqtt();
+    void _probeGateways();
+    void _configureMqtt();
+    void _learnGateways(const String& list);
+    void _onMqttConnected();
+    void _saveSchema();
+    void _announceFeatureChanges();
+    void _scheduleStateFlush();
+    void _flushState();
     void _log(const char* level, const char* msg);
 };
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include "Meo3_Gateway.h"
+#include <WiFi.h>
+#include <WiFiClient.h>
+
+static const uint8_t MEO_GW_GOOD_PROBES   = 3;    // before switching to an endpoint voluntarily
+static const uint32_t MEO_GW_MIN_GAIN_MS  = 5;    // and it must be faster by at least this much
+static const uint8_t MEO_GW_RERESOLVE_AFTER = 4;  // failed probes before a host name is looked up again
+
+MeoGatewaySelector::MeoGatewaySelector()
+    : _active(0),
+      _nextProbe(0),
+      _lastSwitchMs(0),
+      _lostAtMs(0),
+      _switchedSinceLost(false),
+      _hasPrimary(false),
+      _used(false),
+      _lastFailoverMs(0),
+      _failoverCount(0),
+      _probeIntervalMs(30000),
+      _minDwellMs(300000),
+      _probeTimeoutMs(500),
+      _failoverAfter(2),
+      _logger(nullptr) {}
+
+void MeoGatewaySelector::setLogger(MeoLogFunction logger) {
+    _logger = logger;
+}
+
+void MeoGatewaySelector::setPrimary(const char* host, uint16_t mqttPort) {
+    MeoGatewayEndpoint ep;
+    ep.host = host;
+    ep.mqttPort = mqttPort;
+    _resolve(ep, false);
+
+    if (_hasPrimary) {
+        _endpoints[0] = ep;
+    } else {
+        // addGateway() or learned endpoints may already be there: keep them
+        _endpoints.insert(_endpoints.begin(), ep);
+        _active = _used && _endpoints.size() > 1 ? _active + 1 : 0;
+        _hasPrimary = true;
+    }
+
+    // The primary may have been added or learned before under another name
+    for (size_t i = 1; i < _endpoints.size(); i++) {
+        if (_sameEndpoint(_endpoints[0], _endpoints[i])) {
+            _endpoints.erase(_endpoints.begin() + i);
+            if (_active == i) {
+                _active = 0;
+            } else if (_active > i) {
+                _active--;
+            }
+            break;
+        }
+    }
+    if (_active >= _endpoints.size()) _active = 0;
+    if (_nextProbe >= _endpoints.size()) _nextProbe = 0;
+}
+
+bool MeoGatewaySelector::add(const char* host, uint16_t mqttPort, bool learned) {
+    MeoGatewayEndpoint ep;
+    ep.host = host;
+    ep.mqttPort = mqttPort;
+    ep.learned = learned;
+    _resolve(ep, true);
+    return _add(ep);
+}
+
+size_t MeoGatewaySelector::addLearned(const String& list, uint16_t defaultMqttPort, bool localSubnetOnly) {
+    size_t added = 0;
+    int start = 0;
+    while (start < (int)list.length()) {
+        int comma = list.indexOf(',', start);
+        if (comma < 0) comma = list.length();
+
+        String item = list.substring(start, comma);
+        item.trim();
+        if (item.length() > 0) {
+            MeoGatewayEndpoint ep;
+            ep.mqttPort = defaultMqttPort;
+            ep.learned = true;
+            int colon = item.indexOf(':');
+            if (colon > 0) {
+                ep.mqttPort = (uint16_t)item.substring(colon + 1).toInt();
+                item = item.substring(0, colon);
+            }
+            ep.host = item;
+
+            bool resolved = _resolve(ep, true);
+            if (localSubnetOnly) {
+                uint32_t mask = WiFi.subnetMask();
+                if (!resolved || mask == 0 ||
+                    ((uint32_t)ep.address & mask) != ((uint32_t)WiFi.localIP() & mask)) {
+                    if (_logger) {
+                        String msg = "Ignoring gateway " + item + ": not on the local subnet";
+                        _logger("WARN", msg.c_str());
+                    }
+                    start = comma + 1;
+                    continue;
+                }
+            }
+            if (ep.mqttPort != 0 && _add(ep)) {
+                added++;
+            }
+        }
+        start = comma + 1;
+    }
+    return added;
+}
+
+String MeoGatewaySelector::learnedList() const {
+    String list;
+    for (const auto& ep : _endpoints) {
+        if (!ep.learned) continue;
+        if (list.length() > 0) list += ',';
+        list += ep.host + ":" + String(ep.mqttPort);
+    }
+    return list;
+}
+
+const MeoGatewayEndpoint* MeoGatewaySelector::active() const {
+    return _active < _endpoints.size() ? &_endpoints[_active] : nullptr;
+}
+
+const MeoGatewayEndpoint* MeoGatewaySelector::endpoint(size_t index) const {
+    return index < _endpoints.size() ? &_endpoints[index] : nullptr;
+}
+
+void MeoGatewaySelector::reportConnected() {
+    _used = true;
+    if (_active < _endpoints.size()) {
+        _endpoints[_active].failures = 0;
+    }
+
+    if (_lostAtMs != 0 && _switchedSinceLost) {
+        _lastFailoverMs = millis() - _lostAtMs;
+        _failoverCount++;
+        if (_logger) {
+            String msg = "Gateway failover completed in " + String(_lastFailoverMs) + " ms";
+            _logger("INFO", msg.c_str());
+        }
+    }
+    _lostAtMs = 0;
+    _switchedSinceLost = false;
+}
+
+void MeoGatewaySelector::reportLost() {
+    _used = true;
+    if (_lostAtMs == 0) {
+        _lostAtMs = millis();
+        if (_lostAtMs == 0) _lostAtMs = 1;
+    }
+}
+
+bool MeoGatewaySelector::reportConnectFailed() {
+    reportLost();
+    if (_active >= _endpoints.size()) {
+        return false;
+    }
+
+    MeoGatewayEndpoint& current = _endpoints[_active];
+    current.goodProbes = 0;
+    if (current.failures < 255) current.failures++;
+    if (current.failures < _failoverAfter || _endpoints.size() < 2) {
+        return false;
+    }
+
+    // Bounded: one probe per other endpoint, each limited by the probe timeout,
+    // and at most one DNS lookup; unresolved names are retried on the next round
+    bool allowDns = true;
+    for (size_t i = 0; i < _endpoints.size(); i++) {
+        if (i != _active) {
+            bool cached = _endpoints[i].address != IPAddress();
+            _probe(_endpoints[i], allowDns);
+            if (!cached) allowDns = false;
+        }
+    }
+
+    int best = _fastestHealthy(_active);
+    if (best >= 0) {
+        _activate((size_t)best, "active gateway unreachable");
+    } else {
+        // nothing answers: keep rotating instead of retrying one endpoint forever
+        _activate((_active + 1) % _endpoints.size(), "no healthy gateway, trying next");
+    }
+    return true;
+}
+
+bool MeoGatewaySelector::probeNext(bool connected) {
+    if (!connected || _endpoints.size() < 2) {
+        return false;
+    }
+
+    _probe(_endpoints[_nextProbe], true);
+    _nextProbe = (_nextProbe + 1) % _endpoints.size();
+
+    if (millis() - _lastSwitchMs < _minDwellMs) {
+        return false;
+    }
+
+    const MeoGatewayEndpoint& current = _endpoints[_active];
+    int best = _fastestHealthy(_active);
+    if (best < 0 || current.srttMs == 0) {
+        return false;
+    }
+
+    const MeoGatewayEndpoint& candidate = _endpoints[best];
+    uint32_t margin = current.srttMs / 4 > MEO_GW_MIN_GAIN_MS ? current.srttMs / 4 : MEO_GW_MIN_GAIN_MS;
+    if (candidate.goodProbes >= MEO_GW_GOOD_PROBES && candidate.srttMs + margin < current.srttMs) {
+        _activate((size_t)best, "faster gateway");
+        return true;
+    }
+    return false;
+}
+
+bool MeoGatewaySelector::_add(const MeoGatewayEndpoint& ep) {
+    for (const auto& known : _endpoints) {
+        if (_sameEndpoint(known, ep)) {
+            return false;
+        }
+    }
+
+    _endpoints.push_back(ep);
+    if (_logger) {
+        String msg = String(ep.learned ? "Learned gateway " : "Added gateway ") + ep.host + ":" + String(ep.mqttPort);
+        _logger("INFO", msg.c_str());
+    }
+    return true;
+}
+
+bool MeoGatewaySelector::_resolve(MeoGatewayEndpoint& ep, bool allowDns) {
+    if (ep.address != IPAddress()) {
+        return true;
+    }
+    IPAddress literal;
+    if (literal.fromString(ep.host.c_str())) {
+        ep.address = literal;
+        return true;
+    }
+    // hostByName() blocks until the resolver answers or gives up
+    if (!allowDns || WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+    IPAddress resolved;
+    if (WiFi.hostByName(ep.host.c_str(), resolved) != 1 || resolved == IPAddress()) {
+        return false;
+    }
+    ep.address = resolved;
+    return true;
+}
+
+bool MeoGatewaySelector::_sameEndpoint(const MeoGatewayEndpoint& a, const MeoGatewayEndpoint& b) {
+    if (a.mqttPort != b.mqttPort) {
+        return false;
+    }
+    if (a.host == b.host) {
+        return true;
+    }
+    // e.g. "meo-open-service.local" and the address it was learned under
+    return a.address != IPAddress() && a.address == b.address;
+}
+
+bool MeoGatewaySelector::_probe(MeoGatewayEndpoint& ep, bool allowDns) {
+    bool cached = ep.address != IPAddress();
+    if (!cached && !_resolve(ep, allowDns)) {
+        if (!allowDns) {
+            return false;   // not probed this round
+        }
+        if (ep.failures < 255) ep.failures++;
+        ep.goodProbes = 0;
+        return false;
+    }
+
+    // Connect to the address so the timeout covers the whole probe
+    WiFiClient probe;
+    unsigned long start = millis();
+    bool ok = probe.connect(ep.address, ep.mqttPort, (int32_t)_probeTimeoutMs);
+    uint32_t rtt = millis() - start;
+    probe.stop();
+
+    if (ok) {
+        if (rtt == 0) rtt = 1;
+        ep.srttMs = ep.srttMs == 0 ? rtt : (7 * ep.srttMs + rtt) / 8;
+        ep.failures = 0;
+        if (ep.goodProbes < 255) ep.goodProbes++;
+    } else {
+        if (ep.failures < 255) ep.failures++;
+        ep.goodProbes = 0;
+        IPAddress literal;
+        if (ep.failures % MEO_GW_RERESOLVE_AFTER == 0 && !literal.fromString(ep.host.c_str())) {
+            ep.address = IPAddress();   // the name may point elsewhere by now
+        }
+    }
+    return ok;
+}
+
+int MeoGatewaySelector::_fastestHealthy(size_t exclude) const {
+    int best = -1;
+    for (size_t i = 0; i < _endpoints.size(); i++) {
+        if (i == exclude || !_endpoints[i].healthy()) continue;
+        if (best < 0 || _endpoints[i].srttMs < _endpoints[best].srttMs) {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+void MeoGatewaySelector::_activate(size_t index, const char* reason) {
+    _active = index;
+    _lastSwitchMs = millis();
+    if (_lostAtMs != 0) {
+        _switchedSinceLost = true;
+    }
+
+    if (_logger) {
+        const MeoGatewayEndpoint& ep = _endpoints[index];
+        String msg = "Switching to gateway " + ep.host + ":" + String(ep.mqttPort) + " (" + reason + ")";
+        _logger("WARN", msg.c_str());
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Meo3_Type.h"
+
+// One gateway (MQTT broker) of a site. All gateways of a site accept the same
+// device credentials, so switching between them needs no re-registration.
+struct MeoGatewayEndpoint {
+    String    host;
+    uint16_t  mqttPort;
+    IPAddress address;     // resolved host, 0 = not resolved yet
+    bool      learned;     // from discovery / the gateway, not configured in code
+    uint32_t  srttMs;      // smoothed probe round trip, 0 = not measured yet
+    uint8_t   failures;    // consecutive failed probes or connects
+    uint8_t   goodProbes;  // consecutive successful probes
+
+    MeoGatewayEndpoint() : mqttPort(1883), learned(false), srttMs(0), failures(0), goodProbes(0) {}
+    bool healthy() const { return failures == 0 && srttMs != 0; }
+};
+
+// Chooses the gateway to connect to.
+// - Endpoints are probed with a short TCP connect to their MQTT port, one per
+//   probeNext() call (round robin), so probing never stalls loop() for long.
+//   Host names are resolved once and cached (again after repeated failures);
+//   a probe or fail-over round does at most one DNS lookup, the rest connect
+//   to cached addresses within the probe timeout.
+// - Fail-over: after `failoverAfter` failed connects to the active gateway all
+//   others are probed and the fastest healthy one becomes active.
+// - Fail-back/switch with hysteresis: only to an endpoint that passed several
+//   probes in a row, is clearly faster than the active one, and not before the
+//   minimum dwell time since the last switch.
+class MeoGatewaySelector {
+public:
+    MeoGatewaySelector();
+
+    void setLogger(MeoLogFunction logger);
+
+    // Puts the primary gateway (MeoDevice::setGateway) in front of the endpoints
+    // added so far; calling it again replaces the previous primary
+    void setPrimary(const char* host, uint16_t mqttPort);
+    // Returns false if the endpoint is already known (same host, or same resolved address)
+    bool add(const char* host, uint16_t mqttPort, bool learned = false);
+    // "host[:port],host[:port]" as sent by the gateway; returns the number added.
+    // With localSubnetOnly, hosts that do not resolve into the station's subnet
+    // are ignored (a cleartext invoker must not move the device off the LAN).
+    size_t addLearned(const String& list, uint16_t defaultMqttPort, bool localSubnetOnly = false);
+    String learnedList() const;
+
+    size_t count() const { return _endpoints.size(); }
+    const MeoGatewayEndpoint* active() const;
+    const MeoGatewayEndpoint* endpoint(size_t index) const;
+
+    // Probe cadence is driven by the caller (MeoDevice schedules it on its timer wheel)
+    void setProbeInterval(unsigned long ms) { _probeIntervalMs = ms; }
+    unsigned long probeInterval() const { return _probeIntervalMs; }
+    void setProbeTimeout(uint16_t ms) { _probeTimeoutMs = ms; }
+    void setFailoverAfter(uint8_t failedConnects) { _failoverAfter = failedConnects ? failedConnects : 1; }
+
+    // Connection events of the active gateway. The report functions return
+    // true when a different gateway became active and the caller has to
+    // reconfigure and reconnect.
+    void reportConnected();
+    void reportLost();
+    bool reportConnectFailed();
+
+    // Probes the next endpoint (round robin) while connected; true when a
+    // better gateway should be used. Call every probeInterval().
+    bool probeNext(bool connected);
+
+    // Time from losing the connection to being connected again after a switch
+    unsigned long lastFailoverMs() const { return _lastFailoverMs; }
+    uint32_t      failoverCount() const { return _failoverCount; }
+
+private:
+    std::vector<MeoGatewayEndpoint> _endpoints;
+    size_t          _active;
+    size_t          _nextProbe;
+    unsigned long   _lastSwitchMs;
+    unsigned long   _lostAtMs;       // 0 = connected (or never connected)
+    bool            _switchedSinceLost;
+    bool            _hasPrimary;
+    bool            _used;           // a connection was reported at least once
+    unsigned long   _lastFailoverMs;
+    uint32_t        _failoverCount;
+    unsigned long   _probeIntervalMs;
+    unsigned long   _minDwellMs;
+    uint16_t        _probeTimeoutMs;
+    uint8_t         _failoverAfter;
+    MeoLogFunction  _logger;
+
+    bool _add(const MeoGatewayEndpoint& ep);
+    bool _resolve(MeoGatewayEndpoint& ep, bool allowDns);
+    static bool _sameEndpoint(const MeoGatewayEndpoint& a, const MeoGatewayEndpoint& b);
+    bool _probe(MeoGatewayEndpoint& ep, bool allowDns);
+    int  _fastestHealthy(size_t exclude) const;
+    void _activate(size_t index, const char* reason);
+};
@@ -0,0 +1,303 @@
+#include "Meo3_LocalControl.h"
+#include <ArduinoJson.h>
+#include <mbedtls/md.h>
+
+static const size_t   MEO_LOCAL_MAC_LEN     = MeoConfig::LOCAL_MAC_LEN;   // HMAC-SHA256
+static const uint64_t MEO_LOCAL_MAX_SKEW_MS = 30000;
+
+MeoLocalControl::MeoLocalControl()
+    : _port(0),
+      _listening(false),
+      _tracing(false),
+      _clock(nullptr),
+      _dispatcher(nullptr),
+      _logger(nullptr),
+      _evictedSeq(0) {}
+
+void MeoLocalControl::setLogger(MeoLogFunction logger) {
+    _logger = logger;
+}
+
+void MeoLocalControl::configure(const String& deviceId, const String& transmitKey, const MeoClock* clock) {
+    if (deviceId != _deviceId || transmitKey != _transmitKey) {
+        _resetWindows();   // new identity, new sequence space
+    }
+    _deviceId = deviceId;
+    _transmitKey = transmitKey;
+    _clock = clock;
+}
+
+void MeoLocalControl::setDispatcher(Dispatcher dispatcher) {
+    _dispatcher = dispatcher;
+}
+
+void MeoLocalControl::setTracing(bool enabled) {
+    _tracing = enabled;
+}
+
+bool MeoLocalControl::begin(uint16_t port) {
+    if (_listening && port == _port) {
+        return true;
+    }
+    stop();
+
+    if (_transmitKey.length() == 0) {
+        if (_logger) _logger("ERROR", "Local control needs a transmit key; register first");
+        return false;
+    }
+    if (!_udp.begin(port)) {
+        if (_logger) _logger("ERROR", "Local control: failed to open UDP port");
+        return false;
+    }
+
+    _port = port;
+    _listening = true;
+    if (_logger) {
+        String msg = "Local control listening on UDP " + String(port);
+        _logger("INFO", msg.c_str());
+    }
+    return true;
+}
+
+void MeoLocalControl::stop() {
+    if (_listening) {
+        _udp.stop();
+        _listening = false;
+    }
+}
+
+void MeoLocalControl::loop() {
+    if (!_listening) {
+        return;
+    }
+
+    uint8_t datagram[MEO_LOCAL_MAC_LEN + MeoConfig::INVOKE_BUFFER_SIZE];
+    int size;
+    while ((size = _udp.parsePacket()) > 0) {
+        uint32_t receivedUs = micros();
+        if ((size_t)size > sizeof(datagram) - 1) {
+            if (_logger) _logger("WARN", "Local control: datagram too large, dropped");
+            _udp.flush();
+            continue;
+        }
+        int len = _udp.read(datagram, sizeof(datagram) - 1);
+        if (len > 0) {
+            _handleDatagram(datagram, (size_t)len, receivedUs);
+        }
+    }
+}
+
+bool MeoLocalControl::sendResponse(const MeoFeatureCall& call, bool success, const char* message) {
+    if (!_listening || call.origin != MeoCallOrigin::LOCAL_UDP) {
+        return false;
+    }
+
+    StaticJsonDocument<MeoConfig::RESPONSE_JSON_CAPACITY> doc;
+    doc["feature_name"] = call.featureName;
+    doc["request_id"]  = call.requestId;
+    doc["device_id"]   = call.deviceId;
+    doc["success"]     = success;
+    if (message) {
+        doc["message"] = message;
+    }
+
+    const MeoInvokeTrace& trace = call.trace;
+    uint32_t respondUs = micros();
+    if (trace.receivedUs != 0 && (_tracing || call.featureName == "_ping")) {
+        JsonObject t = doc.createNestedObject("trace");
+        t["parse_us"]    = trace.parsedUs - trace.receivedUs;
+        t["dispatch_us"] = trace.handlerStartUs - trace.parsedUs;
+        t["handler_us"]  = respondUs - trace.handlerStartUs;
+        t["total_us"]    = respondUs - trace.receivedUs;
+    }
+
+    uint8_t datagram[MEO_LOCAL_MAC_LEN + MeoConfig::RESPONSE_BUFFER_SIZE];
+    uint8_t* body = datagram + MEO_LOCAL_MAC_LEN;
+    size_t len = serializeJson(doc, reinterpret_cast<char*>(body), MeoConfig::RESPONSE_BUFFER_SIZE);
+    if (len == 0 || !_sign(body, len, datagram)) {
+        if (_logger) _logger("ERROR", "Local control: failed to build response");
+        return false;
+    }
+
+    if (!_udp.beginPacket(call.replyIp, call.replyPort)) {
+        return false;
+    }
+    _udp.write(datagram, MEO_LOCAL_MAC_LEN + len);
+    bool ok = _udp.endPacket() == 1;
+    if (ok && trace.receivedUs != 0) {
+        uint32_t sentUs = micros();
+        _invokeStats.publish.record(sentUs - respondUs);
+        _invokeStats.total.record(sentUs - trace.receivedUs);
+    }
+    return ok;
+}
+
+bool MeoLocalControl::_sign(const uint8_t* body, size_t len, uint8_t* macOut) const {
+    const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    return info && mbedtls_md_hmac(info,
+                                   reinterpret_cast<const unsigned char*>(_transmitKey.c_str()),
+                                   _transmitKey.length(), body, len, macOut) == 0;
+}
+
+void MeoLocalControl::_resetWindows() {
+    for (SeqWindow& w : _windows) {
+        w = SeqWindow();
+    }
+    _evictedSeq = 0;
+}
+
+bool MeoLocalControl::_acceptSeq(const String& sender, uint64_t seq) {
+    // The window lives in RAM only; the clock is what keeps datagrams captured
+    // before a reboot out, so nothing is accepted without it
+    if (seq == 0 || !_clock || !_clock->isSynced()) {
+        return false;
+    }
+
+    uint64_t now = _clock->nowMs();
+    uint64_t skew = seq > now ? seq - now : now - seq;
+    if (skew > MEO_LOCAL_MAX_SKEW_MS) {
+        return false;
+    }
+
+    // Anything stamped before this boot was sent to an earlier run of the
+    // firmware, even if it is still inside the skew window
+    if (seq <= now - millis()) {
+        return false;
+    }
+
+    // seq is the sender's clock, so windows are per sender: two gateways whose
+    // clocks differ do not push each other's datagrams out
+    SeqWindow* window = nullptr;
+    SeqWindow* oldest = &_windows[0];
+    for (SeqWindow& w : _windows) {
+        if (w.highestSeq != 0 && w.sender == sender) {
+            window = &w;
+            break;
+        }
+        if (w.highestSeq < oldest->highestSeq) {
+            oldest = &w;   // unused slots (0) first, then the least recently active sender
+        }
+    }
+
+    if (!window) {
+        // A sender without a window may have lost it to eviction; everything it
+        // sent before that point is treated as seen
+        if (seq <= _evictedSeq) {
+            return false;
+        }
+        if (oldest->highestSeq > _evictedSeq) {
+            _evictedSeq = oldest->highestSeq;
+        }
+        window = oldest;
+        *window = SeqWindow();
+        window->sender = sender;
+    } else if (seq <= window->floorSeq) {
+        return false;   // too old to tell
+    }
+
+    // The window counts datagrams, not milliseconds, so reordering is
+    // tolerated whatever the time between the reordered datagrams
+    uint64_t* slot = &window->recent[0];
+    for (uint64_t& r : window->recent) {
+        if (r == seq) {
+            return false;
+        }
+        if (r < *slot) {
+            slot = &r;   // free slot (0) first, then the oldest seq
+        }
+    }
+    if (*slot > window->floorSeq) {
+        window->floorSeq = *slot;
+    }
+    *slot = seq;
+    if (seq > window->highestSeq) {
+        window->highestSeq = seq;
+    }
+    return true;
+}
+
+void MeoLocalControl::_handleDatagram(uint8_t* data, size_t len, uint32_t receivedUs) {
+    if (len <= MEO_LOCAL_MAC_LEN) {
+        return;
+    }
+
+    uint8_t* body = data + MEO_LOCAL_MAC_LEN;
+    size_t bodyLen = len - MEO_LOCAL_MAC_LEN;
+
+    uint8_t expected[MEO_LOCAL_MAC_LEN];
+    if (!_sign(body, bodyLen, expected)) {
+        return;
+    }
+    uint8_t diff = 0;   // constant time
+    for (size_t i = 0; i < MEO_LOCAL_MAC_LEN; i++) {
+        diff |= expected[i] ^ data[i];
+    }
+    if (diff != 0) {
+        if (_logger) _logger("WARN", "Local control: bad signature, dropped");
+        return;
+    }
+
+    body[bodyLen] = '\0';   // loop() leaves room for it
+    StaticJsonDocument<MeoConfig::INVOKE_JSON_CAPACITY> doc;
+    DeserializationError err = deserializeJson(doc, reinterpret_cast<const char*>(body), bodyLen);
+    if (err) {
+        if (_logger) {
+            String msg = "Local control: failed to parse JSON: ";
+            msg += err.c_str();
+            _logger("ERROR", msg.c_str());
+        }
+        return;
+    }
+
+    JsonVariant seqValue = doc["seq"];
+    if (!seqValue.is<uint64_t>()) {
+        if (_logger) _logger("WARN", "Local control: datagram without seq, dropped");
+        return;
+    }
+    const char* sender = doc["sender"] | "";
+    if (strlen(sender) > MeoConfig::MAX_DEVICE_ID_LEN) {
+        if (_logger) _logger("WARN", "Local control: sender name too long, dropped");
+        return;
+    }
+    if (!_clock || !_clock->isSynced()) {
+        if (_logger) _logger("WARN", "Local control: clock not synced yet, dropped");
+        return;
+    }
+    if (!_acceptSeq(String(sender), seqValue.as<uint64_t>())) {
+        if (_logger) _logger("WARN", "Local control: replayed or stale datagram, dropped");
+        return;
+    }
+
+    const char* feature = doc["feature"] | "";
+    if (feature[0] == '\0') {
+        return;
+    }
+
+    MeoFeatureCall call;
+    call.trace.receivedUs = receivedUs;
+    call.deviceId    = _deviceId;
+    call.featureName = feature;
+    call.requestId   = doc["request_id"] | "";
+    call.origin      = MeoCallOrigin::LOCAL_UDP;
+    call.replyIp     = _udp.remoteIP();
+    call.replyPort   = _udp.remotePort();
+
+    JsonObject params = doc["params"];
+    if (!params.isNull()) {
+        for (JsonPair kv : params) {
+            call.params[String(kv.key().c_str())] = String(kv.value().as<const char*>());
+        }
+    }
+
+    call.trace.parsedUs = micros();
+    if (_dispatcher) {
+        _dispatcher(call);
+    }
+    // No handler start means the call was dropped as a duplicate of an MQTT invoke
+    if (call.trace.handlerStartUs != 0) {
+        _invokeStats.parse.record(call.trace.parsedUs - call.trace.receivedUs);
+    }
+    if (call.trace.handlerEndUs != 0) {   // user handlers only, as on the MQTT path
+        _invokeStats.handler.record(call.trace.handlerEndUs - call.trace.handlerStartUs);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Meo3_Type.h"
+#include "Meo3_Config.h"
+#include "Meo3_Time.h"
+#include "Meo3_Trace.h"
+#include <WiFiUdp.h>
+
+// Optional low-latency control path: the gateway sends feature invocations
+// straight to the device over UDP instead of through the MQTT broker.
+//
+// Datagram (both directions): 32-byte HMAC-SHA256(transmitKey, body) + body
+//   request body:  {"feature": "...", "request_id": "...", "sender": "...", "seq": N, "params": {...}}
+//   response body: same fields as the MQTT feature_response (incl. "trace")
+//
+// seq is required and must strictly increase per sender: the sender's Unix
+// time in ms. "sender" is optional (up to MEO_MAX_DEVICE_ID_LEN characters) and
+// names the gateway; it is covered by the signature, so a replay cannot change
+// it. Replays are rejected by remembering the last MEO_LOCAL_REPLAY_WINDOW seq
+// values of each sender (anything older than those counts as seen, however
+// far apart in time they are), by refusing seq values more than 30 s away from
+// now, and by refusing seq values from before the device booted (the windows
+// do not survive a reboot). All of this needs the device clock, so datagrams
+// are dropped until it is synced.
+class MeoLocalControl {
+public:
+    using Dispatcher = std::function<void(MeoFeatureCall& call)>;
+
+    MeoLocalControl();
+
+    void setLogger(MeoLogFunction logger);
+    void configure(const String& deviceId, const String& transmitKey, const MeoClock* clock);
+    void setDispatcher(Dispatcher dispatcher);
+    void setTracing(bool enabled);
+
+    bool begin(uint16_t port);
+    void stop();
+    void loop();
+    bool isListening() const { return _listening; }
+
+    bool sendResponse(const MeoFeatureCall& call, bool success, const char* message);
+
+    // Per-stage latency of calls that came in on this path; "publish" is the
+    // response datagram send, "total" receive -> response sent
+    const MeoInvokeStats& invokeStats() const { return _invokeStats; }
+    void resetInvokeStats() { _invokeStats.reset(); }
+
+private:
+    WiFiUDP          _udp;
+    uint16_t         _port;
+    bool             _listening;
+    bool             _tracing;
+    String           _deviceId;
+    String           _transmitKey;
+    const MeoClock*  _clock;
+    Dispatcher       _dispatcher;
+    MeoLogFunction   _logger;
+
+    struct SeqWindow {
+        String   sender;
+        uint64_t highestSeq = 0;   // 0: slot unused
+        uint64_t floorSeq = 0;     // this and older count as seen
+        uint64_t recent[MeoConfig::LOCAL_REPLAY_WINDOW] = {};   // accepted above floorSeq
+    };
+    SeqWindow        _windows[MeoConfig::LOCAL_SENDERS];
+    uint64_t         _evictedSeq;   // highest seq of a sender pushed out of _windows
+    MeoInvokeStats   _invokeStats;
+
+    bool _sign(const uint8_t* body, size_t len, uint8_t* macOut) const;
+    bool _acceptSeq(const String& sender, uint64_t seq);
+    void _resetWindows();
+    void _handleDatagram(uint8_t* data, size_t len, uint32_t receivedUs);
+};
@@ -3,16 +3,53 @@
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 
-static WiFiClient    _meoWifiClient;
-static PubSubClient  _meoPubSub(_meoWifiClient);
-
 MeoMqttClient::MeoMqttClient()
     : _port(1883),
       _features(nullptr),
-      _logger(nullptr) {}
+      _logger(nullptr),
+      _local(nullptr),
+      _pubSub(_wifiClient),
+      _brokerVerified(false),
+      _persistentSession(false),
+      _wasConnected(false),
+      _disconnectedAtMs(0),
+      _lastReconnectMs(0),
+      _reconnectCount(0),
+      _recentRequestNext(0),
+      _tracing(false),
+      _compactTopics(false),
+      _txMessages(0),
+      _txBytes(0),
+      _otaEnabled(false),
+      _otaAckEvery(1),
+      _bulkTransferId(0),
+      _bulkChunk(nullptr),
+      _bulkChunkSize(0),
+      _bulkChunkLen(0),
+      _bulkSeq(0),
+      _bulkCrc(0),
+      _bulkStartMs(0),
+      _bulkActive(false) {
+    _pubSub.setBufferSize(MeoConfig::MQTT_BUFFER_SIZE);
+
+    // "_ota" is registered by enableOta() only
+    addReservedMethod("_ping", [this](const MeoFeatureCall& call) {
+        this->sendFeatureResponse(call, true, "pong");
+    });
+}
 
 void MeoMqttClient::setLogger(MeoLogFunction logger) {
     _logger = logger;
+    _ota.setLogger(logger);
+    _tlsClient.setLogger(logger);
+}
+
+void MeoMqttClient::useTls(const char* caCertPem, MeoStorage* sessionCache) {
+    _tlsClient.begin();   // mbedtls contexts live on the heap only once TLS is used
+    _tlsClient.setCACert(caCertPem);
+    _tlsClient.setSessionCache(sessionCache);
+    _pubSub.setClient(_tlsClient);
+    _brokerVerified = caCertPem != nullptr;
 }
 
 void MeoMqttClient::configure(const char* host,
@@ -26,21 +63,27 @@ void MeoMqttClient::configure(const char* host,
     _transmitKey = transmitKey;
     _features = featureRegistry;
 
-    _meoPubSub.setServer(_host.c_str(), _port);
-    _meoPubSub.setCallback(
+    _pubSub.setServer(_host.c_str(), _port);
+    _pubSub.setCallback(
         [this](char* topic, uint8_t* payload, unsigned int length) {
             this->_onMqttMessage(topic, payload, length);
         }
     );
 }
 
+void MeoMqttClient::setPersistentSession(bool enabled) {
+    _persistentSession = enabled;
+}
+
 bool MeoMqttClient::connect() {
+    _markDisconnected();
+
     if (WiFi.status() != WL_CONNECTED) {
         if (_logger) _logger("ERROR", "WiFi not connected, cannot connect MQTT");
         return false;
     }
 
-    if (_meoPubSub.connected()) {
+    if (_pubSub.connected()) {
         return true;
     }
 
@@ -51,44 +94,85 @@ bool MeoMqttClient::connect() {
     }
 
     // Use deviceId/transmitKey as MQTT credentials
-    bool ok = _meoPubSub.connect(clientId.c_str(),
-                                 _deviceId.c_str(),      // username
-                                 _transmitKey.c_str());  // password
+    bool ok = _pubSub.connect(clientId.c_str(),
+                              _deviceId.c_str(),      // username
+                              _transmitKey.c_str(),   // password
+                              nullptr, 0, false, nullptr,
+                              !_persistentSession);   // clean session
 
     if (!ok) {
         if (_logger) _logger("ERROR", "MQTT connection failed");
         return false;
     }
 
+    _wasConnected = true;
+    if (_disconnectedAtMs != 0) {
+        _lastReconnectMs = millis() - _disconnectedAtMs;
+        _reconnectCount++;
+        _disconnectedAtMs = 0;
+        if (_logger) {
+            String msg = "MQTT reconnected in " + String(_lastReconnectMs) + " ms";
+            _logger("INFO", msg.c_str());
+        }
+    }
+
+    if (_compactTopics) {
+        _announceCompact();   // aliases are valid for this connection
+    }
+
+    // Always resubscribe: PubSubClient does not expose CONNACK session-present,
+    // so a session lost to a broker restart or expiry cannot be detected.
+    // subscribe() does not wait for the SUBACK, so this costs no round trip.
     _subscribeFeatureTopics();
     if (_logger) _logger("INFO", "MQTT connected and subscribed");
     return true;
 }
 
+void MeoMqttClient::disconnect() {
+    if (_pubSub.connected()) {
+        _pubSub.disconnect();
+    }
+    _wasConnected = false;   // deliberate, not counted as a lost connection
+}
+
 void MeoMqttClient::loop() {
-    if (_meoPubSub.connected()) {
-        _meoPubSub.loop();
+    if (_pubSub.connected()) {
+        // Queued invokes arrive one packet per call, in broker order
+        _pubSub.loop();
+    } else {
+        _markDisconnected();
+    }
+}
+
+void MeoMqttClient::_markDisconnected() {
+    if (_wasConnected && !_pubSub.connected()) {
+        _wasConnected = false;
+        _disconnectedAtMs = millis();
+        if (_disconnectedAtMs == 0) _disconnectedAtMs = 1;
     }
 }
 
 bool MeoMqttClient::isConnected() const {
-    return _meoPubSub.connected();
+    return _pubSub.connected();
 }
 
-bool MeoMqttClient::publishEvent(const char* eventName, const MeoEventPayload& payload) {
-    if (!_meoPubSub.connected()) {
+bool MeoMqttClient::publishEvent(const char* eventName, const MeoEventPayload& payload, uint64_t timestampMs) {
+    if (!_pubSub.connected()) {
         if (_logger) _logger("WARN", "MQTT not connected, cannot publish event");
         return false;
     }
 
-    String topic = "meo/" + _deviceId + "/event" + "/" + String(eventName);
+    String topic = _eventTopic(eventName);
 
-    StaticJsonDocument<512> doc;
+    StaticJsonDocument<MeoConfig::EVENT_JSON_CAPACITY> doc;
     for (const auto& kv : payload) {
         doc[kv.first] = kv.second;
     }
+    if (timestampMs > 0) {
+        doc["ts"] = timestampMs;
+    }
 
-    char buffer[512];
+    char buffer[MeoConfig::EVENT_BUFFER_SIZE];
     size_t len = serializeJson(doc, buffer, sizeof(buffer));
     if (len == 0) {
         if (_logger) _logger("ERROR", "Failed to serialize event JSON");
@@ -100,43 +184,588 @@ bool MeoMqttClient::publishEvent(const char* eventName, const MeoEventPayload& p
         _logger("DEBUG", msg.c_str());
     }
 
-    return _meoPubSub.publish(topic.c_str(), buffer, len);
+    return _publish(topic.c_str(), reinterpret_cast<const uint8_t*>(buffer), len);
+}
+
+bool MeoMqttClient::publishTimeSeries(const char* eventName, const MeoTimeSeries& series) {
+    if (!_pubSub.connected()) {
+        if (_logger) _logger("WARN", "MQTT not connected, cannot publish time series");
+        return false;
+    }
+
+    size_t n = series.size();
+    if (n == 0) {
+        return true;
+    }
+
+    String topic = _eventTopic(eventName);
+
+    const std::vector<uint64_t>& ts = series.timestamps();
+    const std::vector<int32_t>&  vs = series.values();
+
+    DynamicJsonDocument doc(JSON_OBJECT_SIZE(6) + 2 * JSON_ARRAY_SIZE(n));
+    doc["field"] = series.field().c_str();
+    doc["scale"] = series.scale();
+    doc["t0"]    = ts[0];
+    doc["v0"]    = vs[0];
+    JsonArray dt = doc.createNestedArray("dt");
+    JsonArray dv = doc.createNestedArray("dv");
+    for (size_t i = 1; i < n; i++) {
+        dt.add((int64_t)(ts[i] - ts[i - 1]));
+        dv.add((int64_t)vs[i] - vs[i - 1]);   // up to 2^32, does not fit int32
+    }
+
+    String body;
+    if (doc.overflowed() || serializeJson(doc, body) == 0) {
+        if (_logger) _logger("ERROR", "Failed to serialize time series JSON");
+        return false;
+    }
+
+    if (!_ensureBufferFor(topic.length(), body.length())) {
+        if (_logger) _logger("ERROR", "Not enough memory for time series MQTT buffer");
+        return false;
+    }
+
+    if (_logger) {
+        String msg = "Publishing " + String((unsigned long)n) + " samples to " + topic;
+        _logger("DEBUG", msg.c_str());
+    }
+
+    return _publish(topic.c_str(), reinterpret_cast<const uint8_t*>(body.c_str()), body.length());
+}
+
+bool MeoMqttClient::publishFeatureDelta(const MeoFeatureDelta& delta) {
+    static const char* const LIST_KEYS[] = {"added_events", "removed_events", "added_methods", "removed_methods"};
+
+    if (!_pubSub.connected()) {
+        if (_logger) _logger("WARN", "MQTT not connected, cannot publish feature delta");
+        return false;
+    }
+
+    String topic = "meo/" + _deviceId + "/event/feature_delta";
+
+    const std::vector<String>* lists[] = {&delta.addedEvents, &delta.removedEvents,
+                                          &delta.addedMethods, &delta.removedMethods};
+    std::vector<std::pair<uint8_t, const String*>> names;
+    for (uint8_t l = 0; l < 4; l++) {
+        for (const auto& name : *lists[l]) {
+            names.push_back(std::make_pair(l, &name));
+        }
+    }
+
+    // {"schema_hash":4294967295,"replace":false,"page":999,"pages":999,<4 empty lists>}
+    const size_t headerLen = 143;
+    std::vector<size_t> nameSizes;
+    for (const auto& name : names) {
+        nameSizes.push_back(name.second->length() + 3);   // quotes + comma
+    }
+    std::vector<size_t> pageStarts =
+        MeoRegistrationClient::splitPages(nameSizes, headerLen, MeoConfig::DELTA_PAGE_SIZE);
+    size_t pages = pageStarts.size();
+
+    if (!_ensureBufferFor(topic.length(), MeoConfig::DELTA_PAGE_SIZE)) {
+        if (_logger) _logger("ERROR", "Not enough memory for feature delta MQTT buffer");
+        return false;
+    }
+
+    char buffer[MeoConfig::DELTA_PAGE_SIZE];
+    for (size_t page = 0; page < pages; page++) {
+        size_t first = pageStarts[page];
+        size_t last = page + 1 < pages ? pageStarts[page + 1] : names.size();
+
+        DynamicJsonDocument doc(JSON_OBJECT_SIZE(8) + 4 * JSON_ARRAY_SIZE(0) + JSON_ARRAY_SIZE(last - first));
+        doc["schema_hash"] = delta.schemaHash;
+        doc["replace"]     = delta.replace;
+        doc["page"]        = page;
+        doc["pages"]       = pages;
+        JsonArray arrays[4];
+        for (uint8_t l = 0; l < 4; l++) {
+            arrays[l] = doc.createNestedArray(LIST_KEYS[l]);
+        }
+        for (size_t i = first; i < last; i++) {
+            arrays[names[i].first].add(names[i].second->c_str());
+        }
+
+        size_t len = doc.overflowed() ? 0 : serializeJson(doc, buffer, sizeof(buffer));
+        if (len == 0 || len >= sizeof(buffer)) {
+            if (_logger) _logger("ERROR", "Failed to serialize feature delta JSON");
+            return false;
+        }
+        if (!_publish(topic.c_str(), reinterpret_cast<const uint8_t*>(buffer), len)) {
+            return false;
+        }
+    }
+
+    if (_logger) {
+        String msg = "Announced feature delta: " + String((unsigned long)delta.size()) +
+                     " change(s) in " + String((unsigned long)pages) + " page(s)";
+        _logger("INFO", msg.c_str());
+    }
+    return true;
+}
+
+bool MeoMqttClient::publishState(const MeoStateDocument& state, bool full) {
+    if (!_pubSub.connected()) {
+        if (_logger) _logger("WARN", "MQTT not connected, cannot publish state");
+        return false;
+    }
+
+    String topic = "meo/" + _deviceId + "/event/state_update";
+
+    DynamicJsonDocument doc(state.jsonCapacity(full));
+    state.buildJson(doc, full);
+
+    String body;
+    if (doc.overflowed() || serializeJson(doc, body) == 0) {
+        if (_logger) _logger("ERROR", "Failed to serialize state JSON");
+        return false;
+    }
+
+    if (!_ensureBufferFor(topic.length(), body.length())) {
+        if (_logger) _logger("ERROR", "Not enough memory for state MQTT buffer");
+        return false;
+    }
+
+    if (_logger) {
+        String msg = (full ? "Publishing state snapshot: " : "Publishing state diff: ") + body;
+        _logger("DEBUG", msg.c_str());
+    }
+
+    return _publish(topic.c_str(), reinterpret_cast<const uint8_t*>(body.c_str()), body.length());
 }
 
 bool MeoMqttClient::sendFeatureResponse(const MeoFeatureCall& call, bool success, const char* message) {
-    if (!_meoPubSub.connected()) {
+    if (call.origin == MeoCallOrigin::LOCAL_UDP) {
+        return _local && _local->sendResponse(call, success, message);
+    }
+
+    if (!_pubSub.connected()) {
         if (_logger) _logger("WARN", "MQTT not connected, cannot send feature response");
         return false;
     }
 
-    // You can define a dedicated response topic; here we'll re-use "event" with a special type
-    String topic = "meo/" + _deviceId + "/event/feature_response";
-
-    StaticJsonDocument<512> doc;
-    doc["feature_name"] = call.featureName;
-    doc["request_id"]  = call.requestId;
-    doc["device_id"]   = call.deviceId;
+    // Compact mode answers on meo/{deviceId}/r/{request_id}: the topic carries
+    // the correlation, so the ids are left out of the body. Request ids that
+    // cannot be a topic level go to the full topic with the ids in the body.
+    bool routed = _compactTopics && _isTopicSafe(call.requestId);
+    String topic = routed ? "meo/" + _deviceId + "/r/" + call.requestId
+                          : "meo/" + _deviceId + "/event/feature_response";
+
+    StaticJsonDocument<MeoConfig::RESPONSE_JSON_CAPACITY> doc;
+    if (!routed) {
+        doc["feature_name"] = call.featureName;
+        doc["request_id"]  = call.requestId;
+        doc["device_id"]   = call.deviceId;
+    }
     doc["success"]     = success;
     if (message) {
         doc["message"] = message;
     }
 
-    char buffer[512];
+    const MeoInvokeTrace& trace = call.trace;
+    uint32_t respondUs = micros();
+    if (trace.receivedUs != 0 && (_tracing || call.featureName == "_ping")) {
+        JsonObject t = doc.createNestedObject("trace");
+        t["parse_us"]    = trace.parsedUs - trace.receivedUs;
+        t["dispatch_us"] = trace.handlerStartUs - trace.parsedUs;
+        t["handler_us"]  = respondUs - trace.handlerStartUs;   // until this response
+        t["total_us"]    = respondUs - trace.receivedUs;
+    }
+
+    char buffer[MeoConfig::RESPONSE_BUFFER_SIZE];
     size_t len = serializeJson(doc, buffer, sizeof(buffer));
     if (len == 0) {
         if (_logger) _logger("ERROR", "Failed to serialize feature response JSON");
         return false;
     }
 
-    return _meoPubSub.publish(topic.c_str(), buffer, len);
+    bool ok = _publish(topic.c_str(), reinterpret_cast<const uint8_t*>(buffer), len);
+    if (ok && trace.receivedUs != 0) {
+        uint32_t publishedUs = micros();
+        _invokeStats.publish.record(publishedUs - respondUs);
+        _invokeStats.total.record(publishedUs - trace.receivedUs);
+    }
+    return ok;
+}
+
+void MeoMqttClient::dispatchFeatureCall(MeoFeatureCall& call) {
+    if (_isDuplicateRequest(call.requestId)) {
+        if (_logger) _logger("DEBUG", "Dropping duplicate feature invoke");
+        return;
+    }
+    _dispatchFeatureCall(call);   // stats of other paths are kept by their transport
+}
+
+void MeoMqttClient::setLocalControl(MeoLocalControl* local) {
+    _local = local;
+}
+
+void MeoMqttClient::setTracing(bool enabled) {
+    _tracing = enabled;
+}
+
+bool MeoMqttClient::beginBulk(const char* streamName, size_t chunkSize, uint8_t windowBits) {
+    if (!_pubSub.connected()) {
+        if (_logger) _logger("WARN", "MQTT not connected, cannot start bulk upload");
+        return false;
+    }
+    if (_bulkActive) {
+        if (_logger) _logger("WARN", "Bulk upload already in progress");
+        return false;
+    }
+    if (chunkSize == 0) {
+        return false;
+    }
+    if (!streamName || !_isTopicSafe(String(streamName))) {
+        if (_logger) _logger("ERROR", "Bulk stream name must be one printable topic level (no '/', '+', '#', leading '$')");
+        return false;
+    }
+
+    if (_bulkTransferId == 0) {
+        _bulkTransferId = millis();  // avoid reusing ids across reboots
+    }
+    _bulkTransferId++;
+    _bulkTopic = "meo/" + _deviceId + "/bulk/" + String(streamName) + "/" + String(_bulkTransferId);
+
+    // room for the longest "/{seq}" suffix as well
+    if (!_ensureBufferFor(_bulkTopic.length() + 11, chunkSize)) {
+        if (_logger) _logger("ERROR", "Not enough memory for bulk MQTT buffer");
+        return false;
+    }
+
+    _bulkChunk = new (std::nothrow) uint8_t[chunkSize];
+    if (!_bulkChunk) {
+        if (_logger) _logger("ERROR", "Not enough memory for bulk chunk");
+        return false;
+    }
+    _bulkChunkSize = chunkSize;
+    _bulkChunkLen = 0;
+    _bulkSeq = 0;
+    _bulkCrc = 0;
+
+    if (!_bulkEncoder.begin(windowBits, [this](const uint8_t* data, size_t len) {
+            return this->_bulkSink(data, len);
+        })) {
+        if (_logger) _logger("ERROR", "Failed to start bulk compressor");
+        _bulkRelease();
+        return false;
+    }
+
+    _bulkStartMs = millis();
+    _bulkActive = true;
+    return true;
+}
+
+bool MeoMqttClient::writeBulk(const uint8_t* data, size_t len) {
+    if (!_bulkActive) {
+        return false;
+    }
+
+    _bulkCrc = meoCrc32(data, len, _bulkCrc);
+    if (!_bulkEncoder.write(data, len)) {
+        if (_logger) _logger("ERROR", "Bulk upload aborted while sending chunk");
+        _bulkEncoder.finish();
+        _bulkRelease();
+        return false;
+    }
+    return true;
+}
+
+bool MeoMqttClient::endBulk() {
+    if (!_bulkActive) {
+        return false;
+    }
+
+    bool ok = _bulkEncoder.finish() && _bulkFlushChunk();
+    if (!ok) {
+        if (_logger) _logger("ERROR", "Bulk upload aborted while sending chunk");
+        _bulkRelease();
+        return false;
+    }
+
+    StaticJsonDocument<MeoConfig::STATUS_BUFFER_SIZE> doc;
+    doc["transfer_id"]     = _bulkTransferId;
+    doc["chunks"]          = _bulkSeq;
+    doc["raw_size"]        = _bulkEncoder.bytesIn();
+    doc["compressed_size"] = _bulkEncoder.bytesOut();
+    doc["codec"]           = "lzss";
+    doc["window_bits"]     = _bulkEncoder.windowBits();
+    doc["crc32"]           = _bulkCrc;
+
+    char buffer[MeoConfig::STATUS_BUFFER_SIZE];
+    size_t len = serializeJson(doc, buffer, sizeof(buffer));
+    String topic = _bulkTopic + "/manifest";
+    ok = len > 0 && _publish(topic.c_str(), reinterpret_cast<const uint8_t*>(buffer), len);
+
+    if (_logger) {
+        unsigned long elapsed = millis() - _bulkStartMs;
+        size_t rawSize = _bulkEncoder.bytesIn();
+        size_t packed = _bulkEncoder.bytesOut();
+        String msg = "Bulk upload " + _bulkTopic + ": " + String((unsigned long)rawSize) + " -> " +
+                     String((unsigned long)packed) + " bytes in " + String(_bulkSeq) + " chunks";
+        if (packed > 0) {
+            msg += ", ratio " + String((float)rawSize / packed);
+        }
+        if (elapsed > 0) {
+            msg += ", " + String((float)rawSize / elapsed * 1000.0f / 1024.0f) + " KB/s";
+        }
+        _logger(ok ? "INFO" : "ERROR", msg.c_str());
+    }
+
+    _bulkRelease();
+    return ok;
+}
+
+bool MeoMqttClient::publishBulk(const char* streamName, const uint8_t* data, size_t len,
+                                size_t chunkSize, uint8_t windowBits) {
+    if (!beginBulk(streamName, chunkSize, windowBits)) {
+        return false;
+    }
+    if (!writeBulk(data, len)) {
+        return false;
+    }
+    return endBulk();
+}
+
+bool MeoMqttClient::_bulkSink(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        size_t n = _bulkChunkSize - _bulkChunkLen;
+        if (n > len) n = len;
+        memcpy(_bulkChunk + _bulkChunkLen, data, n);
+        _bulkChunkLen += n;
+        data += n;
+        len -= n;
+
+        if (_bulkChunkLen == _bulkChunkSize && !_bulkFlushChunk()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MeoMqttClient::_bulkFlushChunk() {
+    if (_bulkChunkLen == 0) {
+        return true;
+    }
+
+    String topic = _bulkTopic + "/" + String(_bulkSeq);
+    if (!_publish(topic.c_str(), _bulkChunk, _bulkChunkLen)) {
+        return false;
+    }
+    _bulkSeq++;
+    _bulkChunkLen = 0;
+
+    // let PubSubClient service keepalive between chunks of long transfers
+    _pubSub.loop();
+    return true;
+}
+
+void MeoMqttClient::_bulkRelease() {
+    delete[] _bulkChunk;
+    _bulkChunk = nullptr;
+    _bulkChunkSize = 0;
+    _bulkChunkLen = 0;
+    _bulkActive = false;
+}
+
+void MeoMqttClient::enableOta() {
+    if (_otaEnabled) {
+        return;
+    }
+    _otaEnabled = true;
+    addReservedMethod("_ota", [this](const MeoFeatureCall& call) {
+        this->_handleOtaControl(call);
+    });
+}
+
+void MeoMqttClient::setOtaSink(MeoOtaSink* sink) {
+    _ota.setSink(sink);
+    enableOta();
+}
+
+void MeoMqttClient::setOtaPublicKey(const char* publicKeyPem) {
+    _ota.setPublicKey(publicKeyPem);
+}
+
+void MeoMqttClient::setOtaAllowUnsigned(bool allow) {
+    _ota.setAllowUnsigned(allow);
+}
+
+void MeoMqttClient::_handleOtaControl(const MeoFeatureCall& call) {
+    auto param = [&call](const char* key) -> String {
+        auto it = call.params.find(key);
+        return it != call.params.end() ? it->second : String("");
+    };
+    String action = param("action");
+
+    if (action == "begin") {
+        size_t size = strtoul(param("size").c_str(), nullptr, 10);
+        String chunkParam = param("chunk_size");
+        String ackParam = param("ack_every");
+        size_t chunkSize = chunkParam.length() > 0 ? strtoul(chunkParam.c_str(), nullptr, 10) : 1024;
+        long ackEvery = ackParam.toInt();
+        _otaAckEvery = ackEvery > 0 ? ackEvery : 1;
+
+        // Chunks are received whole into the PubSubClient buffer
+        String chunkTopic = "meo/" + _deviceId + "/feature/_ota_chunk/invoke";
+        if (!_ensureBufferFor(chunkTopic.length(), chunkSize + 4)) {
+            sendFeatureResponse(call, false, "chunk_size too large");
+            return;
+        }
+        bool ok = _ota.begin(size, param("sha256"), chunkSize, param("signature"));
+        sendFeatureResponse(call, ok, ok ? nullptr : "OTA begin failed");
+    } else if (action == "end") {
+        String error;
+        bool ok = _ota.finish(error);
+        sendFeatureResponse(call, ok, ok ? nullptr : error.c_str());
+    } else if (action == "abort") {
+        _ota.abort();
+        sendFeatureResponse(call, true, nullptr);
+    } else if (action == "status") {
+        sendFeatureResponse(call, true, nullptr);
+    } else {
+        sendFeatureResponse(call, false, "unknown OTA action");
+        return;
+    }
+    _publishOtaStatus();
+}
+
+void MeoMqttClient::_handleOtaChunk(const uint8_t* payload, unsigned int length) {
+    if (length < 4) {
+        if (_logger) _logger("WARN", "OTA chunk too short");
+        return;
+    }
+
+    uint32_t seq = ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) |
+                   ((uint32_t)payload[2] << 8) | (uint32_t)payload[3];
+    MeoOtaChunkResult result = _ota.writeChunk(seq, payload + 4, length - 4);
+
+    // payload points into the PubSubClient buffer: only publish after writing the chunk
+    if (result != MeoOtaChunkResult::ACCEPTED ||
+        _ota.nextSeq() % _otaAckEvery == 0 ||
+        _ota.received() == _ota.imageSize()) {
+        _publishOtaStatus();
+    }
+}
+
+bool MeoMqttClient::_publishOtaStatus() {
+    static const char* const STATE_NAMES[] = {"idle", "receiving", "done", "failed"};
+
+    String topic = "meo/" + _deviceId + "/event/ota_status";
+
+    StaticJsonDocument<MeoConfig::STATUS_BUFFER_SIZE> doc;
+    doc["state"]    = STATE_NAMES[static_cast<int>(_ota.state())];
+    doc["next_seq"] = _ota.nextSeq();
+    doc["received"] = _ota.received();
+    doc["size"]     = _ota.imageSize();
+    doc["kbps"]     = _ota.throughputKBps();
+
+    char buffer[MeoConfig::STATUS_BUFFER_SIZE];
+    size_t len = serializeJson(doc, buffer, sizeof(buffer));
+    if (len == 0) {
+        return false;
+    }
+    return _publish(topic.c_str(), reinterpret_cast<const uint8_t*>(buffer), len);
+}
+
+void MeoMqttClient::addReservedMethod(const char* methodName, MeoFeatureCallback callback) {
+    _reservedHandlers[String(methodName)] = callback;
+}
+
+void MeoMqttClient::setCompactTopics(bool enabled) {
+    _compactTopics = enabled;
+    if (enabled && _pubSub.connected()) {
+        _announceCompact();
+    }
+}
+
+void MeoMqttClient::resetTxStats() {
+    _txMessages = 0;
+    _txBytes = 0;
+}
+
+String MeoMqttClient::_eventTopic(const char* eventName) const {
+    if (_compactTopics && _features) {
+        const std::vector<String>& names = _features->eventNames;
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names[i] == eventName) {
+                return "meo/" + _deviceId + "/e/" + String((unsigned long)i);
+            }
+        }
+    }
+    // not registered (or compact mode off): full name
+    return "meo/" + _deviceId + "/event/" + String(eventName);
+}
+
+bool MeoMqttClient::_isTopicSafe(const String& level) {
+    // One short, printable level: no separators or wildcards, nothing a broker
+    // or an ACL treats specially ($SYS...), no control or non-ASCII bytes
+    if (level.length() == 0 || level.length() > MeoConfig::MAX_TOPIC_LEVEL_LEN || level[0] == '$') {
+        return false;
+    }
+    for (unsigned int i = 0; i < level.length(); i++) {
+        char c = level[i];
+        if (c <= ' ' || c > '~' || c == '/' || c == '+' || c == '#') {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MeoMqttClient::_announceCompact() {
+    // Retained, so a gateway (re)starting later still finds the current table
+    String topic = "meo/" + _deviceId + "/compact";
+
+    size_t n = _features ? _features->eventNames.size() : 0;
+    DynamicJsonDocument doc(JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(n));
+    doc["v"] = 1;
+    doc["max_invoke"] = (unsigned long)MeoConfig::INVOKE_BUFFER_SIZE;
+    JsonArray events = doc.createNestedArray("events");   // alias = index
+    for (size_t i = 0; i < n; i++) {
+        events.add(_features->eventNames[i].c_str());
+    }
+
+    String body;
+    if (doc.overflowed() || serializeJson(doc, body) == 0 ||
+        !_ensureBufferFor(topic.length(), body.length())) {
+        if (_logger) _logger("ERROR", "Failed to announce compact topics");
+        return false;
+    }
+    return _publish(topic.c_str(), reinterpret_cast<const uint8_t*>(body.c_str()), body.length(), true);
+}
+
+bool MeoMqttClient::_publish(const char* topic, const uint8_t* payload, size_t len, bool retained) {
+    if (!_pubSub.publish(topic, payload, len, retained)) {
+        return false;
+    }
+
+    // QoS 0 PUBLISH on the wire: fixed header + remaining length + topic length + topic + payload
+    size_t remaining = 2 + strlen(topic) + len;
+    size_t lengthBytes = remaining < 128 ? 1 : remaining < 16384 ? 2 : remaining < 2097152 ? 3 : 4;
+    _txMessages++;
+    _txBytes += 1 + lengthBytes + remaining;
+    return true;
+}
+
+bool MeoMqttClient::_ensureBufferFor(size_t topicLen, size_t payloadLen) {
+    // PubSubClient builds the whole packet in its buffer:
+    // fixed header (up to 5) + topic length (2) + topic + packet id (2) + payload
+    size_t needed = 5 + 2 + topicLen + 2 + payloadLen;
+    if (_pubSub.getBufferSize() >= needed) {
+        return true;
+    }
+    return needed <= 0xFFFF && _pubSub.setBufferSize(needed);
 }
 
 void MeoMqttClient::_subscribeFeatureTopics() {
-    if (!_meoPubSub.connected()) return;
+    if (!_pubSub.connected()) return;
 
     // Subscribe to all feature invocations for this device
     String topic = "meo/" + _deviceId + "/feature/+/invoke";
-    _meoPubSub.subscribe(topic.c_str());
+    if (!_pubSub.subscribe(topic.c_str(), _persistentSession ? 1 : 0)) {
+        if (_logger) _logger("ERROR", "Failed to subscribe to feature topics");
+        return;
+    }
 
     if (_logger) {
         String msg = "Subscribed to feature topics: " + topic;
@@ -145,6 +774,8 @@ void MeoMqttClient::_subscribeFeatureTopics() {
 }
 
 void MeoMqttClient::_onMqttMessage(char* topic, uint8_t* payload, unsigned int length) {
+    uint32_t receivedUs = micros();
+
     if (_logger) {
         String msg = "MQTT message on ";
         msg += topic;
@@ -175,6 +806,14 @@ void MeoMqttClient::_onMqttMessage(char* topic, uint8_t* payload, unsigned int l
         return;
     }
 
+    // Firmware chunks are binary and may exceed the JSON buffer below
+    if (featureName == "_ota_chunk") {
+        if (_otaEnabled) {
+            _handleOtaChunk(payload, length);
+        }
+        return;
+    }
+
     // Parse JSON payload
     // String json;
     // json.reserve(length + 1);
@@ -182,7 +821,7 @@ void MeoMqttClient::_onMqttMessage(char* topic, uint8_t* payload, unsigned int l
     //     json += static_cast<char>(payload[i]);
     // }
 
-    char json[512];
+    char json[MeoConfig::INVOKE_BUFFER_SIZE];
     for(unsigned int i = 0; i < length && i < sizeof(json) - 1; i++) {
         json[i] = static_cast<char>(payload[i]);
     }
@@ -196,7 +835,7 @@ void MeoMqttClient::_onMqttMessage(char* topic, uint8_t* payload, unsigned int l
         msg += String(json);
         _logger("DEBUG", msg.c_str());
     }
-    StaticJsonDocument<512> doc;
+    StaticJsonDocument<MeoConfig::INVOKE_JSON_CAPACITY> doc;
     try {
         DeserializationError err = deserializeJson(doc, json);
         if (err) {
@@ -218,10 +857,16 @@ void MeoMqttClient::_onMqttMessage(char* topic, uint8_t* payload, unsigned int l
     // }
 
     MeoFeatureCall call;
+    call.trace.receivedUs = receivedUs;
     call.deviceId = deviceId;
     call.featureName = featureName;
     call.requestId = doc["request_id"] | "";
 
+    if (_isDuplicateRequest(call.requestId)) {
+        if (_logger) _logger("DEBUG", "Dropping redelivered feature invoke");
+        return;
+    }
+
     // if (_logger) {
     //     String msg = "Invoking feature: " + call.featureName + " (request_id: " + call.requestId + ")";
     //     _logger("INFO", msg.c_str());
@@ -243,10 +888,39 @@ void MeoMqttClient::_onMqttMessage(char* topic, uint8_t* payload, unsigned int l
         }
     }
 
+    call.trace.parsedUs = micros();
+    _invokeStats.parse.record(call.trace.parsedUs - call.trace.receivedUs);
     _dispatchFeatureCall(call);
 }
 
-void MeoMqttClient::_dispatchFeatureCall(const MeoFeatureCall& call) {
+bool MeoMqttClient::_isDuplicateRequest(const String& requestId) {
+    // Only QoS 1 redelivery and the second (UDP) path can repeat an invoke;
+    // with neither, request ids reused by the gateway must still be handled.
+    // MeoDevice always attaches its MeoLocalControl, so check it is listening.
+    bool localActive = _local && _local->isListening();
+    if (requestId.length() == 0 || (!_persistentSession && !localActive)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < MeoConfig::RECENT_REQUEST_IDS; i++) {
+        if (_recentRequestIds[i] == requestId) {
+            return true;
+        }
+    }
+    _recentRequestIds[_recentRequestNext] = requestId;
+    _recentRequestNext = (_recentRequestNext + 1) % MeoConfig::RECENT_REQUEST_IDS;
+    return false;
+}
+
+void MeoMqttClient::_dispatchFeatureCall(MeoFeatureCall& call) {
+    auto reserved = _reservedHandlers.find(call.featureName);
+    if (reserved != _reservedHandlers.end()) {
+        if (reserved->second) {
+            call.trace.handlerStartUs = micros();
+            reserved->second(call);
+        }
+        return;
+    }
+
     if (!_features) return;
 
     auto it = _features->methodHandlers.find(call.featureName);
@@ -261,6 +935,11 @@ void MeoMqttClient::_dispatchFeatureCall(const MeoFeatureCall& call) {
 
     MeoFeatureCallback cb = it->second;
     if (cb) {
+        call.trace.handlerStartUs = micros();
         cb(call);
+        call.trace.handlerEndUs = micros();
+        if (call.origin == MeoCallOrigin::MQTT) {
+            _invokeStats.handler.record(call.trace.handlerEndUs - call.trace.handlerStartUs);
+        }
     }
 }
\ No newline at end of file
@@ -1,6 +1,17 @@
 #pragma once
 
 #include "Meo3_Type.h"
+#include "Meo3_Config.h"
+#include "Meo3_Registration.h"
+#include "Meo3_Compress.h"
+#include "Meo3_Time.h"
+#include "Meo3_Ota.h"
+#include "Meo3_State.h"
+#include "Meo3_Tls.h"
+#include "Meo3_Trace.h"
+#include "Meo3_LocalControl.h"
+#include <WiFiClient.h>
+#include <PubSubClient.h>
 
 class MeoMqttClient {
 public:
@@ -14,27 +25,175 @@ public:
                    const String& transmitKey,
                    MeoFeatureRegistry* featureRegistry);
 
+    // Persistent session: connect with clean-session=false under the stable
+    // client id "meo-{deviceId}" and subscribe at QoS 1, so the broker queues
+    // invokes sent while the device is offline. Redelivered invokes (same
+    // request id) are dropped. Only enable against brokers that persist sessions.
+    void setPersistentSession(bool enabled);
+
+    // MQTT over TLS (usually port 8883). Sessions are cached in sessionCache
+    // and resumed on reconnect and after deep sleep.
+    void useTls(const char* caCertPem, MeoStorage* sessionCache);
+    unsigned long lastTlsHandshakeMs() const { return _tlsClient.lastHandshakeMs(); }
+    bool lastTlsHandshakeResumed() const { return _tlsClient.lastHandshakeResumed(); }
+    // TLS with a CA: whoever publishes an invoke got past the verified broker
+    bool isBrokerVerified() const { return _brokerVerified; }
+
     bool connect();
+    void disconnect();
     void loop();
     bool isConnected() const;
 
-    bool publishEvent(const char* eventName, const MeoEventPayload& payload);
+    // Time from detecting a lost connection to being connected again
+    unsigned long lastReconnectMs() const { return _lastReconnectMs; }
+    uint32_t      reconnectCount() const { return _reconnectCount; }
+
+    // timestampMs (Unix epoch ms) is sent as "ts" when non-zero
+    bool publishEvent(const char* eventName, const MeoEventPayload& payload, uint64_t timestampMs = 0);
+    bool publishTimeSeries(const char* eventName, const MeoTimeSeries& series);
+
+    // Feature-set change after a firmware update, on meo/{deviceId}/event/feature_delta;
+    // split into pages like the discovery broadcast when it does not fit one message
+    bool publishFeatureDelta(const MeoFeatureDelta& delta);
+
+    // State diff (only changed fields) or full snapshot on meo/{deviceId}/event/state_update
+    bool publishState(const MeoStateDocument& state, bool full);
 
+    // Calls that arrived on the local UDP path are answered there
     bool sendFeatureResponse(const MeoFeatureCall& call, bool success, const char* message);
 
+    // Entry point for invocations received on another transport (see MeoLocalControl).
+    // Request ids already seen on either path are dropped, so the gateway can
+    // retry over MQTT when a UDP invoke goes unanswered.
+    void dispatchFeatureCall(MeoFeatureCall& call);
+    void setLocalControl(MeoLocalControl* local);
+
+    // --- Compact topics ---
+    // PubSubClient speaks MQTT 3.1.1 only, so MQTT 5 topic aliases and response
+    // topics are emulated at the topic level. When enabled:
+    //   events    -> meo/{deviceId}/e/{alias}  (alias = index in the event list)
+    //   responses -> meo/{deviceId}/r/{request_id}, body without the ids
+    // The alias table and the largest accepted invoke ("max_invoke") are
+    // published retained on meo/{deviceId}/compact on every connect.
+    void setCompactTopics(bool enabled);
+    bool compactTopics() const { return _compactTopics; }
+
+    // Bytes put on the wire by PUBLISH packets (incl. MQTT headers)
+    uint32_t txMessages() const { return _txMessages; }
+    uint64_t txBytes() const { return _txBytes; }
+    void resetTxStats();
+
+    // --- Invoke latency tracing ---
+    // When enabled, feature responses carry a "trace" object with the time spent
+    // in each stage (us). Per-stage histograms are always kept. The reserved
+    // "_ping" method answers immediately and always includes the trace.
+    // invokeStats() covers MQTT invokes only; see MeoLocalControl::invokeStats().
+    void setTracing(bool enabled);
+    const MeoInvokeStats& invokeStats() const { return _invokeStats; }
+    void resetInvokeStats() { _invokeStats.reset(); }
+
+    // Library-internal methods (names start with '_'); dispatched like user
+    // methods but not announced during registration.
+    void addReservedMethod(const char* methodName, MeoFeatureCallback callback);
+
+    // --- Bulk upload channel ---
+    // Large payloads are LZSS-compressed on the fly and sent as sequenced chunks:
+    //   meo/{deviceId}/bulk/{stream}/{transferId}/{seq}       (binary chunk)
+    //   meo/{deviceId}/bulk/{stream}/{transferId}/manifest    (JSON, sent last)
+    bool beginBulk(const char* streamName, size_t chunkSize = 256, uint8_t windowBits = 10);
+    bool writeBulk(const uint8_t* data, size_t len);
+    bool endBulk();
+    bool publishBulk(const char* streamName, const uint8_t* data, size_t len,
+                     size_t chunkSize = 256, uint8_t windowBits = 10);
+
+    // --- OTA firmware updates ---
+    // Control (JSON invoke, string params) on the reserved feature "_ota":
+    //   action=begin  size, sha256 (hex), chunk_size (default 1024), ack_every (default 1),
+    //                 signature (hex; required once a public key is set)
+    //   action=status report next expected chunk (used to resume after a reconnect)
+    //   action=end    verify SHA-256 and commit the image
+    //   action=abort
+    // Chunks (binary) on meo/{deviceId}/feature/_ota_chunk/invoke:
+    //   4-byte big-endian sequence number followed by the chunk bytes
+    // Progress is reported on meo/{deviceId}/event/ota_status.
+    // Off until enableOta() or setOtaSink(); images must then be signed with the
+    // key from setOtaPublicKey(), unless setOtaAllowUnsigned(true).
+    void enableOta();
+    bool isOtaEnabled() const { return _otaEnabled; }
+    void setOtaSink(MeoOtaSink* sink);   // also enables OTA
+    void setOtaPublicKey(const char* publicKeyPem);
+    // Without a key anyone allowed to invoke "_ota" could install any firmware
+    void setOtaAllowUnsigned(bool allow);
+    MeoOtaState otaState() const { return _ota.state(); }
+    bool isOtaRebootPending() const { return _ota.state() == MeoOtaState::DONE; }
+
 private:
     String           _host;
     uint16_t         _port;
     String           _deviceId;
     String           _transmitKey;
     MeoFeatureRegistry* _features;
+    std::map<String, MeoFeatureCallback> _reservedHandlers;
     MeoLogFunction   _logger;
+    MeoLocalControl* _local;
+
+    // underlying MQTT client objects, one pair per instance so that several
+    // devices can live in the same program (see examples/fleet-smoke-test.cpp)
+    WiFiClient           _wifiClient;
+    MeoTlsClient         _tlsClient;
+    mutable PubSubClient _pubSub;
+
+    bool             _brokerVerified;
+    bool             _persistentSession;
+    bool             _wasConnected;
+    unsigned long    _disconnectedAtMs;
+    unsigned long    _lastReconnectMs;
+    uint32_t         _reconnectCount;
+
+    // QoS 1 may redeliver an invoke and local control may deliver it twice;
+    // remember recent request ids to drop duplicates (only in those modes)
+    String           _recentRequestIds[MeoConfig::RECENT_REQUEST_IDS];
+    uint8_t          _recentRequestNext;
+
+    bool             _tracing;
+    MeoInvokeStats   _invokeStats;
+
+    bool             _compactTopics;
+    uint32_t         _txMessages;
+    uint64_t         _txBytes;
+
+    MeoOtaUpdater    _ota;
+    bool             _otaEnabled;
+    uint32_t         _otaAckEvery;
+
+    // bulk transfer in progress
+    MeoLzssEncoder   _bulkEncoder;
+    String           _bulkTopic;       // meo/{deviceId}/bulk/{stream}/{transferId}
+    uint32_t         _bulkTransferId;
+    uint8_t*         _bulkChunk;
+    size_t           _bulkChunkSize;
+    size_t           _bulkChunkLen;
+    uint32_t         _bulkSeq;
+    uint32_t         _bulkCrc;
+    unsigned long    _bulkStartMs;
+    bool             _bulkActive;
 
-    // underlying MQTT client object (to be defined in .cpp)
-    // e.g., WiFiClient _wifiClient; PubSubClient _mqtt;
+    bool _bulkSink(const uint8_t* data, size_t len);
+    bool _bulkFlushChunk();
+    void _bulkRelease();
 
+    void _handleOtaControl(const MeoFeatureCall& call);
+    void _handleOtaChunk(const uint8_t* payload, unsigned int length);
+    bool _publishOtaStatus();
+    void _markDisconnected();
+    bool _isDuplicateRequest(const String& requestId);
+    bool _ensureBufferFor(size_t topicLen, size_t payloadLen);
+    bool _publish(const char* topic, const uint8_t* payload, size_t len, bool retained = false);
+    String _eventTopic(const char* eventName) const;
+    bool _announceCompact();
+    static bool _isTopicSafe(const String& level);
     void _onMqttMessage(char* topic, uint8_t* payload, unsigned int length);
     void _subscribeFeatureTopics();
 
-    void _dispatchFeatureCall(const MeoFeatureCall& call);
+    void _dispatchFeatureCall(MeoFeatureCall& call);
 };
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include "Meo3_Ota.h"
+#include <Update.h>
+#include <mbedtls/pk.h>
+
+bool MeoUpdateSink::begin(size_t imageSize) {
+    return Update.begin(imageSize > 0 ? imageSize : UPDATE_SIZE_UNKNOWN);
+}
+
+bool MeoUpdateSink::write(const uint8_t* data, size_t len) {
+    // Update.write takes a non-const pointer but does not modify the data
+    return Update.write(const_cast<uint8_t*>(data), len) == len;
+}
+
+bool MeoUpdateSink::end() {
+    return Update.end(true);
+}
+
+void MeoUpdateSink::abort() {
+    Update.abort();
+}
+
+MeoFileSink::MeoFileSink(const char* path)
+    : _path(path),
+      _file(nullptr),
+      _written(0) {}
+
+MeoFileSink::~MeoFileSink() {
+    if (_file) {
+        fclose(_file);
+    }
+}
+
+bool MeoFileSink::begin(size_t imageSize) {
+    abort();
+    _file = fopen(_path.c_str(), "wb");
+    _written = 0;
+    return _file != nullptr;
+}
+
+bool MeoFileSink::write(const uint8_t* data, size_t len) {
+    if (!_file || fwrite(data, 1, len, _file) != len) {
+        return false;
+    }
+    _written += len;
+    return true;
+}
+
+bool MeoFileSink::end() {
+    if (!_file) {
+        return false;
+    }
+    bool ok = fclose(_file) == 0;
+    _file = nullptr;
+    return ok;
+}
+
+void MeoFileSink::abort() {
+    if (_file) {
+        fclose(_file);
+        _file = nullptr;
+        remove(_path.c_str());
+    }
+    _written = 0;
+}
+
+MeoOtaUpdater::MeoOtaUpdater()
+    : _sink(&_updateSink),
+      _logger(nullptr),
+      _publicKeyPem(nullptr),
+      _allowUnsigned(false),
+      _state(MeoOtaState::IDLE),
+      _imageSize(0),
+      _chunkSize(0),
+      _received(0),
+      _nextSeq(0),
+      _shaActive(false),
+      _startMs(0),
+      _endMs(0) {}
+
+MeoOtaUpdater::~MeoOtaUpdater() {
+    _releaseHash();
+}
+
+void MeoOtaUpdater::setSink(MeoOtaSink* sink) {
+    _sink = sink ? sink : &_updateSink;
+}
+
+void MeoOtaUpdater::setLogger(MeoLogFunction logger) {
+    _logger = logger;
+}
+
+void MeoOtaUpdater::setPublicKey(const char* publicKeyPem) {
+    _publicKeyPem = publicKeyPem;
+}
+
+void MeoOtaUpdater::setAllowUnsigned(bool allow) {
+    _allowUnsigned = allow;
+}
+
+bool MeoOtaUpdater::begin(size_t imageSize, const String& sha256Hex, size_t chunkSize,
+                          const String& signatureHex) {
+    if (_state == MeoOtaState::RECEIVING) {
+        abort();
+    }
+
+    if (imageSize == 0 || chunkSize == 0 || sha256Hex.length() != 64) {
+        if (_logger) _logger("ERROR", "OTA begin: invalid size, chunk size or sha256");
+        return false;
+    }
+
+    // Checked up front so an unsigned image is refused before it is streamed
+    _signature.clear();
+    if (!_publicKeyPem && !_allowUnsigned) {
+        if (_logger) _logger("ERROR", "OTA begin: no public key set and unsigned images not allowed");
+        return false;
+    }
+    if (_publicKeyPem) {
+        size_t sigLen = signatureHex.length() / 2;
+        if (sigLen == 0 || sigLen > MBEDTLS_PK_SIGNATURE_MAX_SIZE || signatureHex.length() % 2 != 0) {
+            if (_logger) _logger("ERROR", "OTA begin: signed images only, signature missing or invalid");
+            return false;
+        }
+        _signature.resize(sigLen);
+        for (size_t i = 0; i < sigLen; i++) {
+            char byteHex[3] = {signatureHex[2 * i], signatureHex[2 * i + 1], '\0'};
+            char* end = nullptr;
+            _signature[i] = (uint8_t)strtoul(byteHex, &end, 16);
+            if (end != byteHex + 2) {
+                _signature.clear();
+                if (_logger) _logger("ERROR", "OTA begin: signature is not hex");
+                return false;
+            }
+        }
+    }
+
+    if (!_sink->begin(imageSize)) {
+        _fail("OTA sink refused image");
+        return false;
+    }
+
+    mbedtls_md_init(&_sha);
+    _shaActive = true;
+    if (mbedtls_md_setup(&_sha, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0) != 0 ||
+        mbedtls_md_starts(&_sha) != 0) {
+        _sink->abort();
+        _fail("OTA hash init failed");
+        return false;
+    }
+
+    _imageSize = imageSize;
+    _chunkSize = chunkSize;
+    _received = 0;
+    _nextSeq = 0;
+    _expectedSha256 = sha256Hex;
+    _expectedSha256.toLowerCase();
+    _startMs = millis();
+    _endMs = 0;
+    _state = MeoOtaState::RECEIVING;
+
+    if (_logger) {
+        String msg = "OTA started: " + String((unsigned long)imageSize) + " bytes in chunks of " +
+                     String((unsigned long)chunkSize);
+        _logger("INFO", msg.c_str());
+    }
+    return true;
+}
+
+MeoOtaChunkResult MeoOtaUpdater::writeChunk(uint32_t seq, const uint8_t* data, size_t len) {
+    if (_state != MeoOtaState::RECEIVING) {
+        return MeoOtaChunkResult::REJECTED;
+    }
+    if (seq < _nextSeq) {
+        return MeoOtaChunkResult::DUPLICATE;
+    }
+    if (seq > _nextSeq) {
+        return MeoOtaChunkResult::OUT_OF_ORDER;
+    }
+    if (len == 0 || len > _chunkSize || _received + len > _imageSize) {
+        _sink->abort();
+        _fail("OTA chunk has unexpected size");
+        return MeoOtaChunkResult::REJECTED;
+    }
+
+    if (!_sink->write(data, len)) {
+        _sink->abort();
+        _fail("OTA sink write failed");
+        return MeoOtaChunkResult::REJECTED;
+    }
+    mbedtls_md_update(&_sha, data, len);
+
+    _received += len;
+    _nextSeq++;
+    return MeoOtaChunkResult::ACCEPTED;
+}
+
+bool MeoOtaUpdater::finish(String& errorOut) {
+    if (_state != MeoOtaState::RECEIVING) {
+        errorOut = "no OTA in progress";
+        return false;
+    }
+    if (_received != _imageSize) {
+        errorOut = "image incomplete";
+        return false;   // keep receiving; the sender may resume
+    }
+
+    uint8_t digest[32];
+    mbedtls_md_finish(&_sha, digest);
+    _releaseHash();
+
+    char hex[65];
+    for (int i = 0; i < 32; i++) {
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+    if (_expectedSha256 != hex) {
+        _sink->abort();
+        errorOut = "sha256 mismatch";
+        _fail("OTA image sha256 mismatch");
+        return false;
+    }
+
+    // Checked again here: the key or the policy may have changed mid-transfer
+    if (_publicKeyPem && !_verifySignature(digest)) {
+        _sink->abort();
+        errorOut = "signature invalid";
+        _fail("OTA image signature invalid");
+        return false;
+    }
+    if (!_publicKeyPem && !_allowUnsigned) {
+        _sink->abort();
+        errorOut = "unsigned image";
+        _fail("OTA image unsigned and unsigned images not allowed");
+        return false;
+    }
+
+    if (!_sink->end()) {
+        errorOut = "sink commit failed";
+        _fail("OTA sink failed to commit image");
+        return false;
+    }
+
+    _endMs = millis();
+    _state = MeoOtaState::DONE;
+    if (_logger) {
+        String msg = "OTA image verified and committed, " + String(throughputKBps()) + " KB/s";
+        _logger("INFO", msg.c_str());
+    }
+    return true;
+}
+
+void MeoOtaUpdater::abort() {
+    if (_state == MeoOtaState::RECEIVING) {
+        _sink->abort();
+        if (_logger) _logger("WARN", "OTA aborted");
+    }
+    _releaseHash();
+    _state = MeoOtaState::IDLE;
+}
+
+float MeoOtaUpdater::throughputKBps() const {
+    unsigned long end = _endMs != 0 ? _endMs : millis();
+    unsigned long elapsed = end - _startMs;
+    if (elapsed == 0) {
+        return 0.0f;
+    }
+    return (float)_received / elapsed * 1000.0f / 1024.0f;
+}
+
+void MeoOtaUpdater::_releaseHash() {
+    if (_shaActive) {
+        mbedtls_md_free(&_sha);
+        _shaActive = false;
+    }
+}
+
+bool MeoOtaUpdater::_verifySignature(const uint8_t* digest) {
+    mbedtls_pk_context pk;
+    mbedtls_pk_init(&pk);
+    // length includes the terminating NUL, as mbedtls expects for PEM
+    bool ok = mbedtls_pk_parse_public_key(&pk, reinterpret_cast<const unsigned char*>(_publicKeyPem),
+                                          strlen(_publicKeyPem) + 1) == 0 &&
+              mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, digest, 32,
+                                _signature.data(), _signature.size()) == 0;
+    mbedtls_pk_free(&pk);
+    return ok;
+}
+
+void MeoOtaUpdater::_fail(const char* reason) {
+    _releaseHash();
+    _state = MeoOtaState::FAILED;
+    if (_logger) _logger("ERROR", reason);
+}
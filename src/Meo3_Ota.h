@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Meo3_Type.h"
+#include <mbedtls/md.h>
+#include <stdio.h>
+
+// Destination of firmware bytes. The default sink writes to the inactive OTA
+// partition through the ESP32 Update library; any other storage (e.g. a file
+// standing in for a partition) can be plugged in by implementing this.
+class MeoOtaSink {
+public:
+    virtual ~MeoOtaSink() {}
+    virtual bool begin(size_t imageSize) = 0;
+    virtual bool write(const uint8_t* data, size_t len) = 0;
+    virtual bool end() = 0;      // image complete and verified: make it bootable
+    virtual void abort() = 0;
+};
+
+class MeoUpdateSink : public MeoOtaSink {
+public:
+    bool begin(size_t imageSize) override;
+    bool write(const uint8_t* data, size_t len) override;
+    bool end() override;
+    void abort() override;
+};
+
+// Writes the image to a file through stdio: on the ESP32 a path on a mounted
+// SPIFFS/LittleFS/SD volume (e.g. "/littlefs/fw.bin"), on a host any path.
+// The file is removed again when the transfer is aborted.
+class MeoFileSink : public MeoOtaSink {
+public:
+    explicit MeoFileSink(const char* path);
+    ~MeoFileSink();
+
+    bool begin(size_t imageSize) override;
+    bool write(const uint8_t* data, size_t len) override;
+    bool end() override;
+    void abort() override;
+
+    const String& path() const { return _path; }
+    size_t written() const { return _written; }
+
+private:
+    String _path;
+    FILE*  _file;
+    size_t _written;
+};
+
+enum class MeoOtaState : int {
+    IDLE      = 0,
+    RECEIVING = 1,
+    DONE      = 2,
+    FAILED    = 3
+};
+
+enum class MeoOtaChunkResult : int {
+    ACCEPTED     = 0,
+    DUPLICATE    = 1,   // already written; re-acknowledge
+    OUT_OF_ORDER = 2,   // gap; sender should resume from nextSeq()
+    REJECTED     = 3    // no transfer active or the sink failed
+};
+
+// Streams a firmware image into a sink chunk by chunk, hashing as it goes.
+// Chunks must arrive in sequence; nothing beyond the current chunk is buffered.
+// A transfer survives MQTT reconnects: the sender asks for nextSeq() and resumes.
+//
+// The SHA-256 only protects against corruption: it comes from the same party
+// that sends the image. With a public key set, the image is accepted only with
+// a valid signature (ECDSA or RSA over the SHA-256 of the image, DER, hex).
+// Without a key nothing is accepted, unless unsigned images are allowed explicitly.
+class MeoOtaUpdater {
+public:
+    MeoOtaUpdater();
+    ~MeoOtaUpdater();
+
+    void setSink(MeoOtaSink* sink);   // nullptr restores the Update sink
+    void setLogger(MeoLogFunction logger);
+    // PEM public key; not copied, must outlive the updater
+    void setPublicKey(const char* publicKeyPem);
+    bool requiresSignature() const { return _publicKeyPem != nullptr; }
+    // Accept images without a signature when no key is set (development only)
+    void setAllowUnsigned(bool allow);
+    bool allowsUnsigned() const { return _allowUnsigned; }
+
+    bool begin(size_t imageSize, const String& sha256Hex, size_t chunkSize,
+               const String& signatureHex = String());
+    MeoOtaChunkResult writeChunk(uint32_t seq, const uint8_t* data, size_t len);
+    bool finish(String& errorOut);    // check size and SHA-256, then commit
+    void abort();
+
+    MeoOtaState state() const { return _state; }
+    uint32_t    nextSeq() const { return _nextSeq; }
+    size_t      received() const { return _received; }
+    size_t      imageSize() const { return _imageSize; }
+    size_t      chunkSize() const { return _chunkSize; }
+    float       throughputKBps() const;
+
+private:
+    MeoUpdateSink        _updateSink;
+    MeoOtaSink*          _sink;
+    MeoLogFunction       _logger;
+    const char*          _publicKeyPem;
+    bool                 _allowUnsigned;
+    std::vector<uint8_t> _signature;
+
+    MeoOtaState          _state;
+    size_t               _imageSize;
+    size_t               _chunkSize;
+    size_t               _received;
+    uint32_t             _nextSeq;
+    String               _expectedSha256;
+    mbedtls_md_context_t _sha;
+    bool                 _shaActive;
+    unsigned long        _startMs;
+    unsigned long        _endMs;
+
+    void _releaseHash();
+    bool _verifySignature(const uint8_t* digest);
+    void _fail(const char* reason);
+};
@@ -1,25 +1,49 @@
 #include "Meo3_Registration.h"
 #include <WiFi.h>
 #include <WiFiUdp.h>
+#include <WiFiServer.h>
 #include <ArduinoJson.h>
+#include <algorithm>
+#include <memory>
 
-static const uint16_t MEO_REG_LISTEN_PORT = 8091;
+static const uint16_t MEO_REG_LISTEN_PORT = 8091;   // UDP reply and legacy TCP reply
 static const uint16_t MEO_REG_DISCOVERY_PORT = 8901; // UDP broadcast port on gateway side (for example)
 static const char*    MEO_REG_DISCOVERY_MAGIC = "MEO3_DISCOVERY_V1";
 
+// Retransmissions at 0, 100, 300, 700, 1500, 3100 ms; give up on UDP at 6.3 s
+static const uint8_t       MEO_REG_MAX_TRANSMISSIONS = 6;
+static const unsigned long MEO_REG_FIRST_RETRY_MS    = 100;
+static const unsigned long MEO_REG_UDP_TIMEOUT_MS    = 6300;
+static const unsigned long MEO_REG_TCP_TIMEOUT_MS    = 15000;   // old gateways may take longer
+static const size_t        MEO_REG_REPLY_MAX         = 512;
+
 MeoRegistrationClient::MeoRegistrationClient()
-    : _port(MEO_REG_DISCOVERY_PORT),
-      _logger(nullptr) {}
+    : _gatewayResolved(false),
+      _port(MEO_REG_DISCOVERY_PORT),
+      _logger(nullptr),
+      _discoveryId(0),
+      _tcpFallback(true),
+      _lastTransmissions(0),
+      _lastRegistrationMs(0) {}
 
 void MeoRegistrationClient::setGateway(const char* host, uint16_t port) {
     _gatewayHost = host;
+    _gatewayResolved = false;
     _port = port;
 }
 
+void MeoRegistrationClient::setTcpFallback(bool enabled) {
+    _tcpFallback = enabled;
+}
+
 void MeoRegistrationClient::setLogger(MeoLogFunction logger) {
     _logger = logger;
 }
 
+void MeoRegistrationClient::setMacAddress(const char* mac) {
+    _macAddress = mac ? mac : "";
+}
+
 bool MeoRegistrationClient::registerIfNeeded(const MeoDeviceInfo& devInfo,
                                              const MeoFeatureRegistry& features,
                                              String& deviceIdOut,
@@ -34,126 +58,383 @@ bool MeoRegistrationClient::registerIfNeeded(const MeoDeviceInfo& devInfo,
         return false;
     }
 
-    // 1) Send broadcast to announce ourselves
-    if (!_sendBroadcast(devInfo, features)) {
-        if (_logger) _logger("ERROR", "Failed to send registration broadcast");
+    // Resolve before the clock starts: a slow DNS (or mDNS) lookup must not eat
+    // into the retransmission schedule. The address is kept for later attempts.
+    if (!_resolveGateway() && _gatewayHost.length() > 0 && _logger) {
+        _logger("WARN", "Gateway host does not resolve; discovery is broadcast only");
+    }
+
+    _learnedGateways = "";
+    _lastTransmissions = 0;
+    unsigned long start = millis();
+
+    // 1) Build the discovery pages; every page of one registration carries the
+    //    same discovery_id, which the gateway echoes as the nonce of its reply
+    _discoveryId = (uint32_t)random(1, 0x7FFFFFFF);
+    std::vector<String> pages;
+    if (!buildDiscoveryPages(devInfo, features,
+                             _macAddress.length() > 0 ? _macAddress : WiFi.macAddress(),
+                             WiFi.localIP().toString(), _discoveryId, _tcpFallback, pages)) {
+        if (_logger) _logger("ERROR", "Failed to build discovery pages");
         return false;
     }
 
-    // 2) Listen on TCP 8091 for gateway response
-    String responseJson;
-    if (!_waitForRegistrationResponse(responseJson)) {
+    // 2) Send them (unicast to the configured gateway, if it resolves, and
+    //    broadcast) and retransmit until a gateway answers
+    bool viaUdp = false;
+    if (!_exchange(pages, viaUdp, deviceIdOut, transmitKeyOut)) {
         if (_logger) _logger("ERROR", "Did not receive registration response");
+        _gatewayResolved = false;   // look the host up again next time, it may have moved
         return false;
     }
 
-    // 3) Parse response
-    return _parseRegistrationResponse(responseJson, deviceIdOut, transmitKeyOut);
+    _lastRegistrationMs = millis() - start;
+    if (_logger) {
+        String msg = "Registered via " + String(viaUdp ? "UDP" : "TCP") + " in " +
+                     String(_lastRegistrationMs) + " ms (" + String(_lastTransmissions) + " transmission(s))";
+        _logger("INFO", msg.c_str());
+    }
+    return true;
+}
+
+unsigned long MeoRegistrationClient::transmissionOffsetMs(uint8_t index) {
+    if (index >= MEO_REG_MAX_TRANSMISSIONS) {
+        return NO_TRANSMISSION;
+    }
+    // the gap doubles after every transmission: 0, 100, 300, 700, ...
+    return MEO_REG_FIRST_RETRY_MS * ((1UL << index) - 1);
 }
 
-bool MeoRegistrationClient::_sendBroadcast(const MeoDeviceInfo& devInfo,
-                                           const MeoFeatureRegistry& features) {
-    WiFiUDP udp;
-    if (!udp.begin(MEO_REG_DISCOVERY_PORT)) {
-        if (_logger) _logger("ERROR", "Failed to open UDP for discovery");
-        return false;
+std::vector<size_t> MeoRegistrationClient::splitPages(const std::vector<size_t>& itemSizes,
+                                                      size_t headerLen,
+                                                      size_t pageSize) {
+    std::vector<size_t> pageStarts;
+    pageStarts.push_back(0);
+    size_t used = headerLen;
+    for (size_t i = 0; i < itemSizes.size(); i++) {
+        if (used + itemSizes[i] > pageSize && i > pageStarts.back()) {
+            pageStarts.push_back(i);
+            used = headerLen;
+        }
+        used += itemSizes[i];
     }
+    return pageStarts;
+}
+
+bool MeoRegistrationClient::buildDiscoveryPages(const MeoDeviceInfo& devInfo,
+                                                const MeoFeatureRegistry& features,
+                                                const String& mac,
+                                                const String& ip,
+                                                uint32_t discoveryId,
+                                                bool tcpFallback,
+                                                std::vector<String>& pagesOut) {
+    uint32_t hash = schemaHash(features);
 
-    StaticJsonDocument<1024> doc;
-    doc["magic"]        = MEO_REG_DISCOVERY_MAGIC;  // so gateway can filter
-    doc["label"]        = devInfo.label;
-    doc["model"]        = devInfo.model;
-    doc["manufacturer"] = devInfo.manufacturer;
-    doc["connectionType"]= static_cast<int>(devInfo.connectionType);
-    doc["mac"]          = WiFi.macAddress();
-    doc["ip"]           = WiFi.localIP().toString();
-    doc["listen_port"]  = MEO_REG_LISTEN_PORT;      // tell gateway where to reply
+    auto fillHeader = [&](JsonDocument& doc, size_t page, size_t pages) {
+        doc["magic"]        = MEO_REG_DISCOVERY_MAGIC;  // so gateway can filter
+        doc["label"]        = devInfo.label;
+        doc["model"]        = devInfo.model;
+        doc["manufacturer"] = devInfo.manufacturer;
+        doc["connectionType"]= static_cast<int>(devInfo.connectionType);
+        doc["mac"]          = mac;
+        doc["ip"]           = ip;
+        doc["listen_port"]  = MEO_REG_LISTEN_PORT;      // tell gateway where to reply
+        doc["reply"]        = tcpFallback ? "udp,tcp" : "udp";   // accepted reply transports
+        doc["discovery_id"] = discoveryId;              // groups the pages of one attempt
+        doc["schema_hash"]  = hash;
+        doc["page"]         = page;
+        doc["pages"]        = pages;
+    };
 
-    JsonArray events  = doc.createNestedArray("featureEvents");
+    // Feature names are packed greedily into pages that fit one datagram;
+    // the gateway replies once, after the last page arrived.
+    std::vector<const String*> names;
+    size_t eventCount = features.eventNames.size();
     for (const auto& e : features.eventNames) {
-        events.add(e);
+        names.push_back(&e);
     }
-    JsonArray methods = doc.createNestedArray("featureMethods");
     for (const auto& kv : features.methodHandlers) {
-        methods.add(kv.first);
+        names.push_back(&kv.first);
+    }
+
+    size_t stringBytes = devInfo.label.length() + devInfo.model.length() +
+                         devInfo.manufacturer.length() + mac.length() + ip.length() + 5;
+    size_t headerLen;
+    {
+        DynamicJsonDocument header(JSON_OBJECT_SIZE(15) + 2 * JSON_ARRAY_SIZE(0) + stringBytes);
+        fillHeader(header, 999, 999);
+        header.createNestedArray("featureEvents");
+        header.createNestedArray("featureMethods");
+        headerLen = measureJson(header);
+    }
+
+    std::vector<size_t> nameSizes;
+    for (const auto* name : names) {
+        nameSizes.push_back(name->length() + 3);   // quotes + comma
+    }
+    std::vector<size_t> pageStarts = splitPages(nameSizes, headerLen, MeoConfig::DISCOVERY_DATAGRAM_SIZE);
+    size_t pages = pageStarts.size();
+
+    pagesOut.clear();
+    for (size_t page = 0; page < pages; page++) {
+        size_t first = pageStarts[page];
+        size_t last = page + 1 < pages ? pageStarts[page + 1] : names.size();
+
+        // names are added as const char* and not copied into the document
+        DynamicJsonDocument doc(JSON_OBJECT_SIZE(15) + 2 * JSON_ARRAY_SIZE(0) +
+                                JSON_ARRAY_SIZE(last - first) + stringBytes);
+        fillHeader(doc, page, pages);
+        JsonArray events  = doc.createNestedArray("featureEvents");
+        JsonArray methods = doc.createNestedArray("featureMethods");
+        for (size_t i = first; i < last; i++) {
+            (i < eventCount ? events : methods).add(names[i]->c_str());
+        }
+
+        String body;
+        if (doc.overflowed() || serializeJson(doc, body) == 0 ||
+            body.length() > MeoConfig::DISCOVERY_DATAGRAM_SIZE) {
+            return false;
+        }
+        pagesOut.push_back(body);
+    }
+    return true;
+}
+
+bool MeoRegistrationClient::_resolveGateway() {
+    if (_gatewayResolved) {
+        return true;
+    }
+    if (_gatewayHost.length() == 0) {
+        return false;
+    }
+    IPAddress address;
+    if (!address.fromString(_gatewayHost.c_str()) &&
+        WiFi.hostByName(_gatewayHost.c_str(), address) != 1) {
+        return false;
     }
+    _gatewayAddress = address;
+    _gatewayResolved = true;
+    return true;
+}
 
-    char buffer[1024];
-    size_t len = serializeJson(doc, buffer, sizeof(buffer));
-    if (len == 0) {
-        if (_logger) _logger("ERROR", "Failed to serialize discovery JSON");
-        udp.stop();
+void MeoRegistrationClient::_sendPages(WiFiUDP& udp, const std::vector<String>& pages,
+                                       const IPAddress& target) {
+    for (const auto& page : pages) {
+        udp.beginPacket(target, _port);
+        udp.write(reinterpret_cast<const uint8_t*>(page.c_str()), page.length());
+        udp.endPacket();
+    }
+}
+
+bool MeoRegistrationClient::_exchange(const std::vector<String>& pages, bool& viaUdp,
+                                      String& deviceIdOut, String& transmitKeyOut) {
+    // The reply socket doubles as the sender, so source port == listen_port
+    WiFiUDP udp;
+    if (!udp.begin(MEO_REG_LISTEN_PORT)) {
+        if (_logger) _logger("ERROR", "Failed to open UDP for discovery");
         return false;
     }
 
+    // Old gateways connect back over TCP instead of answering the datagram
+    std::unique_ptr<WiFiServer> server;
+    if (_tcpFallback) {
+        server.reset(new WiFiServer(MEO_REG_LISTEN_PORT));
+        server->begin();
+    }
+
     IPAddress broadcastIP = ~WiFi.subnetMask() | WiFi.gatewayIP(); // standard broadcast calc
+    bool haveUnicast = _gatewayResolved;   // resolved by registerIfNeeded(), outside the timing
+    IPAddress unicastIP = _gatewayAddress;
+
     if (_logger) {
-        String msg = "Sending discovery broadcast to ";
+        String msg = "Sending discovery to ";
+        if (haveUnicast) {
+            msg += unicastIP.toString();
+            msg += " and ";
+        }
         msg += broadcastIP.toString();
         msg += ":";
-        msg += MEO_REG_DISCOVERY_PORT;
+        msg += _port;
+        msg += " (";
+        msg += (unsigned long)pages.size();
+        msg += " page(s))";
         _logger("INFO", msg.c_str());
     }
 
-    udp.beginPacket(broadcastIP, MEO_REG_DISCOVERY_PORT);
-    udp.write((const uint8_t*)buffer, len);
-    udp.endPacket();
+    unsigned long start = millis();
+    unsigned long deadline = _tcpFallback ? MEO_REG_TCP_TIMEOUT_MS : MEO_REG_UDP_TIMEOUT_MS;
+    char reply[MEO_REG_REPLY_MAX];
+    String responseJson;
+    bool ok = false;
+
+    while (!ok && millis() - start < deadline) {
+        unsigned long elapsed = millis() - start;
+        unsigned long sendAt = transmissionOffsetMs(_lastTransmissions);
+        if (sendAt != NO_TRANSMISSION && elapsed >= sendAt) {
+            // Broadcasts on WiFi are sent without link-layer retries, hence the retransmissions
+            if (haveUnicast) {
+                _sendPages(udp, pages, unicastIP);
+            }
+            _sendPages(udp, pages, broadcastIP);
+            _lastTransmissions++;
+        }
+
+        int size = udp.parsePacket();
+        if (size > 0) {
+            int len = udp.read(reply, sizeof(reply) - 1);
+            if (len > 0 && size < (int)sizeof(reply)) {
+                reply[len] = '\0';
+                responseJson = reply;
+                viaUdp = true;
+                _learnedGateways = udp.remoteIP().toString();
+                ok = _parseRegistrationResponse(responseJson, true, deviceIdOut, transmitKeyOut);
+            }
+        }
+
+        if (!ok && server) {
+            WiFiClient client = server->available();
+            if (client) {
+                if (_logger) _logger("INFO", "Gateway connected for registration");
+                viaUdp = false;
+                _learnedGateways = client.remoteIP().toString();
+                ok = _readTcpResponse(client, responseJson) &&
+                     _parseRegistrationResponse(responseJson, false, deviceIdOut, transmitKeyOut);
+            }
+        }
+
+        if (!ok) {
+            delay(2);
+        }
+    }
+
     udp.stop();
+    if (server) {
+        server->stop();
+    }
 
-    return true;
+    if (ok && _logger) {
+        String msg = "Received registration response: ";
+        msg += responseJson;
+        _logger("DEBUG", msg.c_str());
+    }
+    if (!ok) {
+        _learnedGateways = "";
+    }
+    return ok;
 }
 
-bool MeoRegistrationClient::_waitForRegistrationResponse(String& responseJson) {
-    WiFiServer server(MEO_REG_LISTEN_PORT);
-    server.begin();
-
-    if (_logger) _logger("INFO", "Listening for registration response on TCP port 8091");
+bool MeoRegistrationClient::_readTcpResponse(WiFiClient& client, String& responseJson) {
+    // Read until newline or timeout
+    responseJson = "";
+    unsigned long connStart = millis();
+    while (client.connected() && (millis() - connStart) < 5000) {
+        while (client.available()) {
+            char c = client.read();
+            if (c == '\n') {
+                client.stop();
+                return true;
+            }
+            responseJson += c;
+        }
+        delay(10);
+    }
 
-    unsigned long start = millis();
-    const unsigned long timeoutMs = 15000;  // 15s
+    client.stop();
+    return false;
+}
 
-    while ((millis() - start) < timeoutMs) {
-        WiFiClient client = server.available();
-        if (!client) {
-            delay(50);
-            continue;
+uint32_t MeoRegistrationClient::schemaHash(const MeoFeatureRegistry& features) {
+    // FNV-1a over "e:<events>|m:<methods>", both sorted, so it does not depend
+    // on the order features were added in
+    uint32_t hash = 2166136261UL;
+    auto mix = [&hash](const String& s) {
+        for (unsigned int i = 0; i < s.length(); i++) {
+            hash ^= (uint8_t)s[i];
+            hash *= 16777619UL;
         }
+    };
+    mix(String("e:"));
+    mix(joinEventNames(features));
+    mix(String("|m:"));
+    mix(joinMethodNames(features));
+    return hash;
+}
 
-        if (_logger) _logger("INFO", "Gateway connected for registration");
-
-        // Read until newline or timeout
-        responseJson = "";
-        unsigned long connStart = millis();
-        while (client.connected() && (millis() - connStart) < 5000) {
-            while (client.available()) {
-                char c = client.read();
-                if (c == '\n') {
-                    client.stop();
-                    server.stop();
-                    if (_logger) {
-                        String msg = "Received registration response: ";
-                        msg += responseJson;
-                        _logger("DEBUG", msg.c_str());
-                    }
-                    return true;
-                }
-                responseJson += c;
-            }
-            delay(10);
+String MeoRegistrationClient::joinEventNames(const MeoFeatureRegistry& features) {
+    std::vector<String> sorted(features.eventNames);
+    std::sort(sorted.begin(), sorted.end());
+
+    String joined;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (i > 0) joined += ',';
+        joined += sorted[i];
+    }
+    return joined;
+}
+
+String MeoRegistrationClient::joinMethodNames(const MeoFeatureRegistry& features) {
+    // std::map keeps the names sorted already
+    String joined;
+    for (const auto& kv : features.methodHandlers) {
+        if (joined.length() > 0) joined += ',';
+        joined += kv.first;
+    }
+    return joined;
+}
+
+static std::vector<String> meoSplitNames(const String& joined) {
+    std::vector<String> names;
+    int start = 0;
+    while (start < (int)joined.length()) {
+        int comma = joined.indexOf(',', start);
+        if (comma < 0) comma = joined.length();
+        if (comma > start) {
+            names.push_back(joined.substring(start, comma));
         }
+        start = comma + 1;
+    }
+    return names;
+}
 
-        client.stop();
+static void meoDiffNames(const std::vector<String>& before,
+                         const std::vector<String>& after,
+                         std::vector<String>& addedOut,
+                         std::vector<String>& removedOut) {
+    for (const auto& name : after) {
+        if (std::find(before.begin(), before.end(), name) == before.end()) {
+            addedOut.push_back(name);
+        }
+    }
+    for (const auto& name : before) {
+        if (std::find(after.begin(), after.end(), name) == after.end()) {
+            removedOut.push_back(name);
+        }
     }
+}
 
-    server.stop();
-    if (_logger) _logger("ERROR", "Timeout waiting for registration TCP connection");
-    return false;
+MeoFeatureDelta MeoRegistrationClient::computeDelta(const MeoFeatureRegistry& features,
+                                                    bool haveStored,
+                                                    const String& storedEvents,
+                                                    const String& storedMethods) {
+    MeoFeatureDelta delta;
+    delta.schemaHash = schemaHash(features);
+    delta.replace = !haveStored;
+
+    std::vector<String> events = meoSplitNames(joinEventNames(features));
+    std::vector<String> methods = meoSplitNames(joinMethodNames(features));
+    std::vector<String> oldEvents = haveStored ? meoSplitNames(storedEvents) : std::vector<String>();
+    std::vector<String> oldMethods = haveStored ? meoSplitNames(storedMethods) : std::vector<String>();
+
+    meoDiffNames(oldEvents, events, delta.addedEvents, delta.removedEvents);
+    meoDiffNames(oldMethods, methods, delta.addedMethods, delta.removedMethods);
+    return delta;
 }
 
 bool MeoRegistrationClient::_parseRegistrationResponse(const String& json,
+                                                       bool viaUdp,
                                                        String& deviceIdOut,
                                                        String& transmitKeyOut) {
-    StaticJsonDocument<256> doc;
+    StaticJsonDocument<MeoConfig::REGISTRATION_JSON_CAPACITY> doc;
     DeserializationError err = deserializeJson(doc, json);
     if (err) {
         if (_logger) {
@@ -164,6 +445,13 @@ bool MeoRegistrationClient::_parseRegistrationResponse(const String& json,
         return false;
     }
 
+    // A UDP reply must echo our discovery_id; anything else (a late reply to
+    // an earlier attempt, another device's reply) is ignored
+    if (viaUdp && (doc["discovery_id"] | 0UL) != _discoveryId) {
+        if (_logger) _logger("DEBUG", "Ignoring registration reply for another discovery");
+        return false;
+    }
+
     if (!doc.containsKey("device_id") || !doc.containsKey("transmit_key")) {
         if (_logger) _logger("ERROR", "Registration response missing fields");
         return false;
@@ -171,5 +459,11 @@ bool MeoRegistrationClient::_parseRegistrationResponse(const String& json,
 
     deviceIdOut    = doc["device_id"].as<const char*>();
     transmitKeyOut = doc["transmit_key"].as<const char*>();
+
+    const char* gateways = doc["gateways"] | "";
+    if (gateways[0] != '\0') {
+        if (_learnedGateways.length() > 0) _learnedGateways += ',';
+        _learnedGateways += gateways;
+    }
     return true;
 }
\ No newline at end of file
@@ -1,32 +1,112 @@
 #pragma once
 
 #include "Meo3_Type.h"
+#include "Meo3_Config.h"
+#include <WiFiUdp.h>
+#include <WiFiClient.h>
+
+// Difference between the feature set the gateway knows and the current one.
+// With replace=true (no stored schema to diff against) the "added" lists hold
+// the complete feature set.
+struct MeoFeatureDelta {
+    uint32_t schemaHash;
+    bool     replace;
+    std::vector<String> addedEvents;
+    std::vector<String> removedEvents;
+    std::vector<String> addedMethods;
+    std::vector<String> removedMethods;
+
+    MeoFeatureDelta() : schemaHash(0), replace(false) {}
+    size_t size() const {
+        return addedEvents.size() + removedEvents.size() + addedMethods.size() + removedMethods.size();
+    }
+};
 
 class MeoRegistrationClient {
 public:
     MeoRegistrationClient();
 
-    // For this model, gateway host/port are only needed for broadcast if you want unicast
+    // Discovery is sent unicast to host (if it resolves) as well as broadcast on port
     void setGateway(const char* host, uint16_t port);
     void setLogger(MeoLogFunction logger);
 
+    // Override the MAC announced during discovery (defaults to WiFi.macAddress()).
+    // Used to give virtual devices distinct identities.
+    void setMacAddress(const char* mac);
+
     // Perform registration if no credentials exist.
-    // 1) broadcast IP/MAC/features
-    // 2) listen on TCP 8091 for gateway response
+    // 1) send IP/MAC/features by UDP (unicast to the gateway host if it resolves,
+    //    and broadcast), split into pages if they do not fit one datagram
+    // 2) the gateway answers by unicast UDP to port 8091, echoing discovery_id;
+    //    unanswered discoveries are retransmitted on an exponential schedule
+    // 3) with the TCP fallback on, old gateways may still connect to TCP 8091
     bool registerIfNeeded(const MeoDeviceInfo& devInfo,
                           const MeoFeatureRegistry& features,
                           String& deviceIdOut,
                           String& transmitKeyOut);
 
+    // Also accept the legacy TCP reply (default on). Off: no inbound TCP
+    // listener is opened and registration gives up after 6.3 s.
+    void setTcpFallback(bool enabled);
+
+    unsigned long lastRegistrationMs() const { return _lastRegistrationMs; }
+    uint8_t lastTransmissions() const { return _lastTransmissions; }
+
+    // Gateways learned from the last registration: the one that answered plus
+    // the optional "gateways" field of the response ("host[:port],...")
+    const String& learnedGateways() const { return _learnedGateways; }
+
+    // --- Feature schema ---
+    // Stable FNV-1a hash of the (sorted) event and method names
+    static uint32_t schemaHash(const MeoFeatureRegistry& features);
+    // Comma-separated sorted names, as kept in MeoStorage
+    static String joinEventNames(const MeoFeatureRegistry& features);
+    static String joinMethodNames(const MeoFeatureRegistry& features);
+    static MeoFeatureDelta computeDelta(const MeoFeatureRegistry& features,
+                                        bool haveStored,
+                                        const String& storedEvents,
+                                        const String& storedMethods);
+
+    // --- Discovery building blocks (no network; covered by the host tests) ---
+    // When transmission `index` (0-based) goes out, in ms after the first one;
+    // NO_TRANSMISSION once the retransmission budget is used up
+    static const unsigned long NO_TRANSMISSION = 0xFFFFFFFFUL;
+    static unsigned long transmissionOffsetMs(uint8_t index);
+    // Greedy packing of items with the given serialized sizes into pages of at
+    // most pageSize bytes, each with a fixed header; returns the first item of
+    // every page (an item too large for any page gets a page of its own)
+    static std::vector<size_t> splitPages(const std::vector<size_t>& itemSizes,
+                                          size_t headerLen,
+                                          size_t pageSize);
+    // The discovery datagrams of one registration attempt
+    static bool buildDiscoveryPages(const MeoDeviceInfo& devInfo,
+                                    const MeoFeatureRegistry& features,
+                                    const String& mac,
+                                    const String& ip,
+                                    uint32_t discoveryId,
+                                    bool tcpFallback,
+                                    std::vector<String>& pagesOut);
+
 private:
     String         _gatewayHost;
+    IPAddress      _gatewayAddress;    // _gatewayHost resolved, valid if _gatewayResolved
+    bool           _gatewayResolved;
     uint16_t       _port;
+    String         _macAddress;
     MeoLogFunction _logger;
+    uint32_t       _discoveryId;
+    String         _learnedGateways;
+    bool           _tcpFallback;
+    uint8_t        _lastTransmissions;
+    unsigned long  _lastRegistrationMs;
 
-    bool _sendBroadcast(const MeoDeviceInfo& devInfo,
-                        const MeoFeatureRegistry& features);
-    bool _waitForRegistrationResponse(String& responseJson);
+    bool _resolveGateway();
+    void _sendPages(WiFiUDP& udp, const std::vector<String>& pages, const IPAddress& target);
+    bool _exchange(const std::vector<String>& pages, bool& viaUdp,
+                   String& deviceIdOut, String& transmitKeyOut);
+    bool _readTcpResponse(WiFiClient& client, String& responseJson);
     bool _parseRegistrationResponse(const String& json,
+                                    bool viaUdp,
                                     String& deviceIdOut,
                                     String& transmitKeyOut);
 };
\ No newline at end of file
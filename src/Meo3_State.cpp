@@ -0,0 +1,70 @@
+#include "Meo3_State.h"
+
+MeoStateDocument::MeoStateDocument()
+    : _version(0),
+      _publishedVersion(0) {}
+
+bool MeoStateDocument::set(const String& key, const String& value) {
+    auto it = _fields.find(key);
+    if (it != _fields.end() && it->second.value == value) {
+        return false;
+    }
+
+    _version++;
+    Field& field = _fields[key];
+    field.value = value;
+    field.version = _version;
+    return true;
+}
+
+String MeoStateDocument::get(const String& key) const {
+    auto it = _fields.find(key);
+    return it != _fields.end() ? it->second.value : String("");
+}
+
+bool MeoStateDocument::has(const String& key) const {
+    return _fields.find(key) != _fields.end();
+}
+
+size_t MeoStateDocument::applyDesired(const MeoEventPayload& desired, MeoStateCallback cb) {
+    size_t changed = 0;
+    for (const auto& kv : desired) {
+        if (set(kv.first, kv.second)) {
+            changed++;
+            if (cb) {
+                cb(kv.first, kv.second);
+            }
+        }
+    }
+    return changed;
+}
+
+size_t MeoStateDocument::jsonCapacity(bool full) const {
+    size_t count = 0;
+    size_t strings = 0;
+    for (const auto& kv : _fields) {
+        if (full || kv.second.version > _publishedVersion) {
+            count++;
+            strings += JSON_STRING_SIZE(kv.first.length()) + JSON_STRING_SIZE(kv.second.value.length());
+        }
+    }
+    return JSON_OBJECT_SIZE(4) + JSON_OBJECT_SIZE(count) + strings;
+}
+
+void MeoStateDocument::buildJson(JsonDocument& doc, bool full) const {
+    doc["version"]      = _version;
+    doc["base_version"] = full ? 0 : _publishedVersion;
+    doc["full"]         = full;
+
+    JsonObject state = doc.createNestedObject("state");
+    for (const auto& kv : _fields) {
+        if (full || kv.second.version > _publishedVersion) {
+            // String keys/values are copied into the document
+            state[kv.first] = kv.second.value;
+        }
+    }
+}
+
+void MeoStateDocument::markPublished() {
+    _publishedVersion = _version;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Meo3_Type.h"
+#include <ArduinoJson.h>
+
+// Called for every field changed by a desired-state update from the gateway
+using MeoStateCallback = std::function<void(const String& key, const String& value)>;
+
+// Versioned device state. Every change bumps the document version and stamps
+// the field with it; publishing a diff sends only fields newer than the last
+// published version, together with that base version so the gateway can
+// detect a missed diff and ask for a snapshot.
+class MeoStateDocument {
+public:
+    MeoStateDocument();
+
+    // Returns true if the value changed
+    bool set(const String& key, const String& value);
+    String get(const String& key) const;
+    bool has(const String& key) const;
+
+    uint32_t version() const { return _version; }
+    uint32_t publishedVersion() const { return _publishedVersion; }
+    bool hasPendingChanges() const { return _version != _publishedVersion; }
+
+    // Apply desired values; cb is called for each field that actually changed
+    size_t applyDesired(const MeoEventPayload& desired, MeoStateCallback cb);
+
+    // Fill doc with {"version", "base_version", "full", "state": {...}}
+    size_t jsonCapacity(bool full) const;
+    void buildJson(JsonDocument& doc, bool full) const;
+    void markPublished();
+
+private:
+    struct Field {
+        String   value;
+        uint32_t version;
+    };
+
+    std::map<String, Field> _fields;
+    uint32_t _version;
+    uint32_t _publishedVersion;
+};
@@ -1,12 +1,18 @@
 #include "Meo3_Storage.h"
 #include <Preferences.h>
 
-static const char* NAMESPACE = "meo3";
+static const char* DEFAULT_NAMESPACE = "meo3";
 static const char* KEY_DEVICE_ID = "device_id";
 static const char* KEY_TX_KEY    = "tx_key";
+static const char* KEY_SCHEMA_HASH    = "schema_hash";
+static const char* KEY_SCHEMA_EVENTS  = "schema_ev";
+static const char* KEY_SCHEMA_METHODS = "schema_me";
+static const char* KEY_TLS_SESSION    = "tls_session";
+static const char* KEY_GATEWAYS       = "gateways";
 
 MeoStorage::MeoStorage()
-    : _initialized(false) {}
+    : _namespace(DEFAULT_NAMESPACE),
+      _initialized(false) {}
 
 bool MeoStorage::begin() {
     // Preferences opens NVS namespace lazily; we just mark initialized here.
@@ -14,13 +20,17 @@ bool MeoStorage::begin() {
     return true;
 }
 
+void MeoStorage::setNamespace(const char* ns) {
+    _namespace = (ns && ns[0]) ? ns : DEFAULT_NAMESPACE;
+}
+
 bool MeoStorage::loadCredentials(String& deviceIdOut, String& transmitKeyOut) {
     if (!_initialized && !begin()) {
         return false;
     }
 
     Preferences prefs;
-    if (!prefs.begin(NAMESPACE, true)) { // read-only
+    if (!prefs.begin(_namespace.c_str(), true)) { // read-only
         return false;
     }
 
@@ -43,7 +53,7 @@ bool MeoStorage::saveCredentials(const String& deviceId, const String& transmitK
     }
 
     Preferences prefs;
-    if (!prefs.begin(NAMESPACE, false)) { // read-write
+    if (!prefs.begin(_namespace.c_str(), false)) { // read-write
         return false;
     }
 
@@ -59,12 +69,135 @@ bool MeoStorage::clearCredentials() {
     }
 
     Preferences prefs;
-    if (!prefs.begin(NAMESPACE, false)) {
+    if (!prefs.begin(_namespace.c_str(), false)) {
         return false;
     }
 
     prefs.remove(KEY_DEVICE_ID);
     prefs.remove(KEY_TX_KEY);
+    prefs.remove(KEY_SCHEMA_HASH);
+    prefs.remove(KEY_SCHEMA_EVENTS);
+    prefs.remove(KEY_SCHEMA_METHODS);
+    prefs.remove(KEY_TLS_SESSION);
+    prefs.remove(KEY_GATEWAYS);
+    prefs.end();
+    return true;
+}
+
+bool MeoStorage::loadGateways(String& listOut) {
+    if (!_initialized && !begin()) {
+        return false;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(_namespace.c_str(), true)) {
+        return false;
+    }
+
+    listOut = prefs.getString(KEY_GATEWAYS, "");
+    prefs.end();
+    return listOut.length() > 0;
+}
+
+bool MeoStorage::saveGateways(const String& list) {
+    if (!_initialized && !begin()) {
+        return false;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(_namespace.c_str(), false)) {
+        return false;
+    }
+
+    bool ok = list.length() > 0 ? prefs.putString(KEY_GATEWAYS, list) > 0 : prefs.remove(KEY_GATEWAYS);
+    prefs.end();
+    return ok;
+}
+
+bool MeoStorage::loadSchema(uint32_t& hashOut, String& eventsOut, String& methodsOut) {
+    if (!_initialized && !begin()) {
+        return false;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(_namespace.c_str(), true)) {
+        return false;
+    }
+
+    bool found = prefs.isKey(KEY_SCHEMA_HASH);
+    if (found) {
+        hashOut = prefs.getUInt(KEY_SCHEMA_HASH, 0);
+        eventsOut = prefs.getString(KEY_SCHEMA_EVENTS, "");
+        methodsOut = prefs.getString(KEY_SCHEMA_METHODS, "");
+    }
+    prefs.end();
+    return found;
+}
+
+bool MeoStorage::saveSchema(uint32_t hash, const String& events, const String& methods) {
+    if (!_initialized && !begin()) {
+        return false;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(_namespace.c_str(), false)) {
+        return false;
+    }
+
+    // Empty lists are legitimate, so only the hash write is checked
+    bool ok = prefs.putUInt(KEY_SCHEMA_HASH, hash) > 0;
+    prefs.putString(KEY_SCHEMA_EVENTS, events);
+    prefs.putString(KEY_SCHEMA_METHODS, methods);
+    prefs.end();
+    return ok;
+}
+
+size_t MeoStorage::loadTlsSession(uint8_t* buffer, size_t capacity) {
+    if (!_initialized && !begin()) {
+        return 0;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(_namespace.c_str(), true)) {
+        return 0;
+    }
+
+    size_t len = prefs.getBytesLength(KEY_TLS_SESSION);
+    if (len == 0 || len > capacity) {
+        prefs.end();
+        return 0;
+    }
+    len = prefs.getBytes(KEY_TLS_SESSION, buffer, capacity);
+    prefs.end();
+    return len;
+}
+
+bool MeoStorage::saveTlsSession(const uint8_t* data, size_t len) {
+    if (!_initialized && !begin()) {
+        return false;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(_namespace.c_str(), false)) {
+        return false;
+    }
+
+    bool ok = prefs.putBytes(KEY_TLS_SESSION, data, len) == len;
+    prefs.end();
+    return ok;
+}
+
+bool MeoStorage::clearTlsSession() {
+    if (!_initialized && !begin()) {
+        return false;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(_namespace.c_str(), false)) {
+        return false;
+    }
+
+    prefs.remove(KEY_TLS_SESSION);
     prefs.end();
     return true;
 }
\ No newline at end of file
@@ -8,10 +8,28 @@ public:
 
     bool begin();  // initialize NVS/EEPROM
 
+    // NVS namespace holding the credentials (max 15 chars, default "meo3").
+    // Give every virtual device its own namespace when running several in one program.
+    void setNamespace(const char* ns);
+
     bool loadCredentials(String& deviceIdOut, String& transmitKeyOut);
     bool saveCredentials(const String& deviceId, const String& transmitKey);
-    bool clearCredentials();
+    bool clearCredentials();   // also forgets schema, TLS session and learned gateways
+
+    // Feature schema announced to the gateway: hash plus comma-separated names
+    bool loadSchema(uint32_t& hashOut, String& eventsOut, String& methodsOut);
+    bool saveSchema(uint32_t hash, const String& events, const String& methods);
+
+    // Gateways learned at runtime, "host:port,host:port"
+    bool loadGateways(String& listOut);
+    bool saveGateways(const String& list);
+
+    // Serialized TLS session (ticket or session id) for resuming after reconnect/deep sleep
+    size_t loadTlsSession(uint8_t* buffer, size_t capacity);   // 0 if none
+    bool saveTlsSession(const uint8_t* data, size_t len);
+    bool clearTlsSession();
 
 private:
-    bool _initialized;
+    String _namespace;
+    bool   _initialized;
 };
\ No newline at end of file
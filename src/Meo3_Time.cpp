@@ -0,0 +1,83 @@
+#include "Meo3_Time.h"
+#include <time.h>
+#include <sys/time.h>
+
+// Anything before this (2020-09-13) means SNTP has not set the clock yet
+static const time_t MEO_MIN_VALID_EPOCH = 1600000000;
+
+MeoClock::MeoClock()
+    : _syncEpochMs(0),
+      _syncMillis(0),
+      _manualSynced(false),
+      _sntpStarted(false) {}
+
+void MeoClock::beginSntp(const char* server) {
+    configTime(0, 0, server);
+    _sntpStarted = true;
+}
+
+void MeoClock::syncTo(uint64_t epochMs) {
+    _syncEpochMs = epochMs;
+    _syncMillis = millis();
+    _manualSynced = true;
+}
+
+bool MeoClock::isSynced() const {
+    uint64_t ignored;
+    return _sntpNowMs(ignored) || _manualSynced;
+}
+
+uint64_t MeoClock::nowMs() const {
+    uint64_t epochMs;
+    if (_sntpNowMs(epochMs)) {
+        return epochMs;
+    }
+    if (_manualSynced) {
+        // unsigned subtraction stays correct across millis() rollover
+        return _syncEpochMs + (unsigned long)(millis() - _syncMillis);
+    }
+    return 0;
+}
+
+bool MeoClock::_sntpNowMs(uint64_t& epochMsOut) const {
+    if (!_sntpStarted) {
+        return false;
+    }
+
+    struct timeval tv;
+    if (gettimeofday(&tv, nullptr) != 0 || tv.tv_sec < MEO_MIN_VALID_EPOCH) {
+        return false;
+    }
+    epochMsOut = (uint64_t)tv.tv_sec * 1000ULL + tv.tv_usec / 1000;
+    return true;
+}
+
+MeoTimeSeries::MeoTimeSeries(const char* field, float scale, size_t capacity)
+    : _field(field),
+      _scale(scale > 0 ? scale : 1.0f),
+      _capacity(capacity) {
+    _timestamps.reserve(capacity);
+    _values.reserve(capacity);
+}
+
+bool MeoTimeSeries::add(uint64_t timestampMs, float value) {
+    if (isFull()) {
+        return false;
+    }
+
+    // Rounded in double; NaN and anything outside int32 is refused, the
+    // float-to-int conversion would be undefined
+    double scaled = (double)value * _scale;
+    double rounded = scaled < 0 ? scaled - 0.5 : scaled + 0.5;
+    if (!(rounded > -2147483649.0 && rounded < 2147483648.0)) {
+        return false;
+    }
+    _timestamps.push_back(timestampMs);
+    _values.push_back((int32_t)rounded);
+    return true;
+}
+
+void MeoTimeSeries::clear() {
+    _timestamps.clear();
+    _values.clear();
+}
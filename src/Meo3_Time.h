@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+// Wall clock for event timestamps (Unix epoch, milliseconds).
+// Synced either by SNTP or by the gateway (reserved "_time_sync" method);
+// SNTP wins when both are available.
+class MeoClock {
+public:
+    MeoClock();
+
+    void beginSntp(const char* server = "pool.ntp.org");
+    void syncTo(uint64_t epochMs);
+
+    bool     isSynced() const;
+    uint64_t nowMs() const;   // 0 while not synced
+
+private:
+    uint64_t      _syncEpochMs;
+    unsigned long _syncMillis;
+    bool          _manualSynced;
+    bool          _sntpStarted;
+
+    bool _sntpNowMs(uint64_t& epochMsOut) const;
+};
+
+// Samples of one numeric field, published as a single delta-encoded message:
+//   {"field": "...", "scale": 100, "t0": <epoch ms>, "v0": <scaled value>,
+//    "dt": [t1-t0, t2-t1, ...], "dv": [v1-v0, v2-v1, ...]}
+// Values are stored as round(value * scale), which must fit in int32; the
+// deltas are computed in int64, so any two stored values can follow each other.
+class MeoTimeSeries {
+public:
+    MeoTimeSeries(const char* field, float scale = 100.0f, size_t capacity = 32);
+
+    bool add(uint64_t timestampMs, float value);   // false when full or out of range
+    void clear();
+
+    size_t size() const { return _timestamps.size(); }
+    bool   isFull() const { return _timestamps.size() >= _capacity; }
+
+    const String& field() const { return _field; }
+    float scale() const { return _scale; }
+    const std::vector<uint64_t>& timestamps() const { return _timestamps; }
+    const std::vector<int32_t>&  values() const { return _values; }
+
+private:
+    String                _field;
+    float                 _scale;
+    size_t                _capacity;
+    std::vector<uint64_t> _timestamps;
+    std::vector<int32_t>  _values;
+};
@@ -0,0 +1,292 @@
+#include "Meo3_Timer.h"
+
+static const uint32_t MEO_TIMER_SPAN0 = 64;          // ticks covered by level 0
+static const uint32_t MEO_TIMER_SPAN1 = 64 * 64;
+static const uint32_t MEO_TIMER_SPAN2 = 64 * 64 * 64;
+
+static inline uint64_t meoRotate(uint64_t bits, uint8_t start) {
+    return start ? (bits >> start) | (bits << (64 - start)) : bits;
+}
+
+MeoTimerWheel::MeoTimerWheel()
+    : _freeHead(0),
+      _activeCount(0),
+      _tick(1),   // tick 0 counts as processed
+      _lastMs(0),
+      _carryMs(0),
+      _started(false) {
+    for (uint8_t l = 0; l < LEVELS; l++) {
+        _occupied[l] = 0;
+        for (uint8_t s = 0; s < SLOTS; s++) {
+            _heads[l][s] = NONE;
+        }
+    }
+    for (uint16_t i = 0; i < MeoConfig::MAX_TIMERS; i++) {
+        _timers[i].state = State::FREE;
+        _timers[i].generation = 0;
+        _timers[i].next = i + 1 < MeoConfig::MAX_TIMERS ? i + 1 : NONE;
+    }
+}
+
+MeoTimerId MeoTimerWheel::every(uint32_t periodMs, MeoTimerCallback callback) {
+    uint32_t period = _toTicks(periodMs);
+    uint32_t now = _nowTick();
+    // next multiple of the period: timers with related periods line up
+    uint32_t expiry = (now / period + 1) * period;
+    return _add(expiry, period, callback);
+}
+
+MeoTimerId MeoTimerWheel::after(uint32_t delayMs, MeoTimerCallback callback) {
+    return _add(_nowTick() + _toTicks(delayMs), 0, callback);
+}
+
+bool MeoTimerWheel::cancel(MeoTimerId id) {
+    Timer* tm = _lookup(id);
+    if (!tm) {
+        return false;
+    }
+
+    uint16_t index = (uint16_t)(tm - _timers);
+    switch (tm->state) {
+        case State::QUEUED:
+            _unlink(index);
+            tm->state = State::FREE;
+            tm->generation++;
+            tm->callback = nullptr;
+            tm->next = _freeHead;
+            _freeHead = index;
+            _activeCount--;
+            return true;
+        case State::DUE:
+            tm->state = State::CANCELLED;   // released by _runTick
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool MeoTimerWheel::isActive(MeoTimerId id) const {
+    Timer* tm = _lookup(id);
+    return tm && (tm->state == State::QUEUED || tm->state == State::DUE);
+}
+
+uint32_t MeoTimerWheel::advance(uint32_t nowMs) {
+    if (!_started) {
+        _started = true;
+        _lastMs = nowMs;
+    }
+
+    uint32_t elapsed = nowMs - _lastMs + _carryMs;
+    _lastMs = nowMs;
+    _carryMs = elapsed % MeoConfig::TIMER_TICK_MS;
+    uint32_t current = _tick - 1 + elapsed / MeoConfig::TIMER_TICK_MS;
+
+    // Jump from event to event; ticks without anything due are never visited
+    while ((int32_t)(current - _tick) >= 0) {
+        uint32_t next = _nextEventTick();
+        if ((int32_t)(next - current) > 0) {
+            _tick = current + 1;
+            break;
+        }
+        _runTick(next, current);
+    }
+    return msUntilNext();
+}
+
+uint32_t MeoTimerWheel::msUntilNext() const {
+    if (_activeCount == 0) {
+        return NO_DEADLINE;
+    }
+
+    uint32_t now = _nowTick();
+    uint32_t next = _nextEventTick();
+    if ((int32_t)(next - now) <= 0) {
+        return 0;
+    }
+    uint32_t intoTick = _started ? (millis() - _lastMs + _carryMs) % MeoConfig::TIMER_TICK_MS : 0;
+    return (next - now) * MeoConfig::TIMER_TICK_MS - intoTick;
+}
+
+MeoTimerId MeoTimerWheel::_add(uint32_t expiry, uint32_t period, MeoTimerCallback callback) {
+    if (_freeHead == NONE || !callback) {
+        return 0;
+    }
+    if (!_started) {
+        _started = true;
+        _lastMs = millis();
+    }
+
+    uint16_t index = _freeHead;
+    Timer& tm = _timers[index];
+    _freeHead = tm.next;
+
+    tm.callback = callback;
+    tm.expiry = expiry;
+    tm.period = period;
+    tm.state = State::QUEUED;
+    _insert(index);
+    _activeCount++;
+
+    return ((MeoTimerId)tm.generation << 16) | (index + 1);
+}
+
+MeoTimerWheel::Timer* MeoTimerWheel::_lookup(MeoTimerId id) const {
+    uint16_t index = (uint16_t)(id & 0xFFFF);
+    if (index == 0 || index > MeoConfig::MAX_TIMERS) {
+        return nullptr;
+    }
+    const Timer& tm = _timers[index - 1];
+    if (tm.state == State::FREE || tm.generation != (uint16_t)(id >> 16)) {
+        return nullptr;
+    }
+    return const_cast<Timer*>(&tm);
+}
+
+void MeoTimerWheel::_insert(uint16_t index) {
+    Timer& tm = _timers[index];
+    uint32_t delta = tm.expiry - _tick;
+    if ((int32_t)delta < 0) {
+        tm.expiry = _tick;   // overdue: next tick processed
+        delta = 0;
+    }
+
+    if (delta < MEO_TIMER_SPAN0) {
+        tm.level = 0;
+        tm.slot = tm.expiry & (SLOTS - 1);
+    } else if (delta < MEO_TIMER_SPAN1) {
+        tm.level = 1;
+        tm.slot = (tm.expiry >> SLOT_BITS) & (SLOTS - 1);
+    } else if (delta < MEO_TIMER_SPAN2) {
+        tm.level = 2;
+        tm.slot = (tm.expiry >> (2 * SLOT_BITS)) & (SLOTS - 1);
+    } else {
+        // beyond the wheel: park in the farthest level-2 slot, re-placed when it cascades
+        tm.level = 2;
+        tm.slot = ((_tick + MEO_TIMER_SPAN2 - 1) >> (2 * SLOT_BITS)) & (SLOTS - 1);
+    }
+
+    uint16_t& head = _heads[tm.level][tm.slot];
+    tm.prev = NONE;
+    tm.next = head;
+    if (head != NONE) {
+        _timers[head].prev = index;
+    }
+    head = index;
+    _occupied[tm.level] |= (uint64_t)1 << tm.slot;
+}
+
+void MeoTimerWheel::_unlink(uint16_t index) {
+    Timer& tm = _timers[index];
+    if (tm.prev != NONE) {
+        _timers[tm.prev].next = tm.next;
+    } else {
+        _heads[tm.level][tm.slot] = tm.next;
+    }
+    if (tm.next != NONE) {
+        _timers[tm.next].prev = tm.prev;
+    }
+    if (_heads[tm.level][tm.slot] == NONE) {
+        _occupied[tm.level] &= ~((uint64_t)1 << tm.slot);
+    }
+}
+
+void MeoTimerWheel::_cascade(uint8_t level, uint8_t slot) {
+    uint16_t index = _heads[level][slot];
+    _heads[level][slot] = NONE;
+    _occupied[level] &= ~((uint64_t)1 << slot);
+
+    while (index != NONE) {
+        uint16_t next = _timers[index].next;
+        _insert(index);   // lands on a lower level (or stays parked)
+        index = next;
+    }
+}
+
+void MeoTimerWheel::_runTick(uint32_t tick, uint32_t current) {
+    // _tick is the first unprocessed tick; cascades place timers relative to it
+    _tick = tick;
+    if ((tick & (SLOTS - 1)) == 0) {
+        if (((tick >> SLOT_BITS) & (SLOTS - 1)) == 0) {
+            _cascade(2, (tick >> (2 * SLOT_BITS)) & (SLOTS - 1));
+        }
+        _cascade(1, (tick >> SLOT_BITS) & (SLOTS - 1));
+    }
+
+    // Detach the slot so timers (re)scheduled by callbacks cannot extend this run
+    uint8_t slot = tick & (SLOTS - 1);
+    uint16_t index = _heads[0][slot];
+    _heads[0][slot] = NONE;
+    _occupied[0] &= ~((uint64_t)1 << slot);
+    for (uint16_t i = index; i != NONE; i = _timers[i].next) {
+        _timers[i].state = State::DUE;
+    }
+    _tick = tick + 1;
+
+    while (index != NONE) {
+        Timer& tm = _timers[index];
+        uint16_t next = tm.next;
+
+        if (tm.state == State::DUE && tm.period != 0) {
+            tm.expiry += tm.period;
+            if ((int32_t)(tm.expiry - current) <= 0) {
+                // loop() was stalled: skip the missed periods, stay aligned
+                tm.expiry += ((current - tm.expiry) / tm.period + 1) * tm.period;
+            }
+            tm.state = State::QUEUED;
+            _insert(index);
+            MeoTimerCallback callback = tm.callback;   // may cancel itself
+            callback();
+        } else {
+            MeoTimerCallback callback;
+            if (tm.state == State::DUE) {
+                callback.swap(tm.callback);
+            }
+            tm.state = State::FREE;
+            tm.generation++;
+            tm.callback = nullptr;
+            tm.next = _freeHead;
+            _freeHead = index;
+            _activeCount--;
+            if (callback) {
+                callback();
+            }
+        }
+        index = next;
+    }
+}
+
+uint32_t MeoTimerWheel::_nextEventTick() const {
+    uint32_t best = _tick + 0x7FFFFFFFUL;
+
+    if (_occupied[0]) {
+        uint8_t start = _tick & (SLOTS - 1);
+        uint32_t at = _tick + __builtin_ctzll(meoRotate(_occupied[0], start));
+        if ((int32_t)(at - best) < 0) best = at;
+    }
+    if (_occupied[1]) {
+        uint32_t boundary = (_tick + MEO_TIMER_SPAN0 - 1) & ~(MEO_TIMER_SPAN0 - 1);
+        uint8_t start = (boundary >> SLOT_BITS) & (SLOTS - 1);
+        uint32_t at = boundary + MEO_TIMER_SPAN0 * __builtin_ctzll(meoRotate(_occupied[1], start));
+        if ((int32_t)(at - best) < 0) best = at;
+    }
+    if (_occupied[2]) {
+        uint32_t boundary = (_tick + MEO_TIMER_SPAN1 - 1) & ~(MEO_TIMER_SPAN1 - 1);
+        uint8_t start = (boundary >> (2 * SLOT_BITS)) & (SLOTS - 1);
+        uint32_t at = boundary + MEO_TIMER_SPAN1 * __builtin_ctzll(meoRotate(_occupied[2], start));
+        if ((int32_t)(at - best) < 0) best = at;
+    }
+    return best;
+}
+
+uint32_t MeoTimerWheel::_nowTick() const {
+    if (!_started) {
+        return _tick - 1;
+    }
+    // ticks up to _tick - 1 were processed at _lastMs; add what elapsed since
+    return _tick - 1 + (millis() - _lastMs + _carryMs) / MeoConfig::TIMER_TICK_MS;
+}
+
+uint32_t MeoTimerWheel::_toTicks(uint32_t ms) {
+    uint32_t ticks = (ms + MeoConfig::TIMER_TICK_MS - 1) / MeoConfig::TIMER_TICK_MS;
+    return ticks ? ticks : 1;
+}
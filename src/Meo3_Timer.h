@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Meo3_Type.h"
+#include "Meo3_Config.h"
+
+using MeoTimerCallback = std::function<void()>;
+using MeoTimerId = uint32_t;   // 0 = invalid
+
+// Hierarchical timer wheel: 3 levels of 64 slots (tick, 64 ticks, 4096 ticks),
+// each with an occupancy bitmap. Schedule and cancel are O(1); advancing skips
+// empty stretches using the bitmaps instead of visiting every tick. Timers live
+// in a fixed pool of MeoConfig::MAX_TIMERS entries, so nothing is allocated
+// after construction (except by the std::function itself for large captures).
+//
+// Periodic timers are phase-aligned to multiples of their period, so timers
+// whose periods divide each other fire in the same tick.
+class MeoTimerWheel {
+public:
+    static const uint32_t NO_DEADLINE = 0xFFFFFFFFUL;
+
+    MeoTimerWheel();
+
+    MeoTimerId every(uint32_t periodMs, MeoTimerCallback callback);
+    MeoTimerId after(uint32_t delayMs, MeoTimerCallback callback);
+    bool cancel(MeoTimerId id);   // safe from inside any callback
+    bool isActive(MeoTimerId id) const;
+
+    // Runs everything due up to nowMs (usually millis()); returns ms until the
+    // next deadline, NO_DEADLINE if nothing is scheduled. The value may be a
+    // little early (a higher level needs cascading) but never late.
+    uint32_t advance(uint32_t nowMs);
+    uint32_t msUntilNext() const;
+
+    size_t activeCount() const { return _activeCount; }
+
+private:
+    static const uint8_t  LEVELS = 3;
+    static const uint8_t  SLOT_BITS = 6;
+    static const uint8_t  SLOTS = 1 << SLOT_BITS;
+    static const uint16_t NONE = 0xFFFF;
+
+    enum class State : uint8_t { FREE, QUEUED, DUE, CANCELLED };
+
+    struct Timer {
+        MeoTimerCallback callback;
+        uint32_t expiry;      // tick
+        uint32_t period;      // ticks, 0 = one-shot
+        uint16_t next;
+        uint16_t prev;
+        uint16_t generation;
+        uint8_t  level;
+        uint8_t  slot;
+        State    state;
+    };
+
+    Timer    _timers[MeoConfig::MAX_TIMERS];
+    uint16_t _heads[LEVELS][SLOTS];
+    uint64_t _occupied[LEVELS];
+    uint16_t _freeHead;
+    size_t   _activeCount;
+
+    uint32_t _tick;          // next tick to process
+    uint32_t _lastMs;
+    uint32_t _carryMs;       // ms not yet converted to ticks
+    bool     _started;
+
+    MeoTimerId _add(uint32_t expiry, uint32_t period, MeoTimerCallback callback);
+    Timer*     _lookup(MeoTimerId id) const;
+    void       _insert(uint16_t index);
+    void       _unlink(uint16_t index);
+    void       _cascade(uint8_t level, uint8_t slot);
+    void       _runTick(uint32_t tick, uint32_t current);   // current: latest tick now due
+    uint32_t   _nextEventTick() const;
+    uint32_t   _nowTick() const;
+    static uint32_t _toTicks(uint32_t ms);
+};
@@ -0,0 +1,395 @@
+#include "Meo3_Tls.h"
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/error.h>
+#include <memory>
+#include <new>
+#include <string.h>
+
+static const char*  MEO_TLS_PERS = "meo3-tls";
+
+struct MeoTlsContexts {
+    mbedtls_ssl_context      ssl;
+    mbedtls_ssl_config       conf;
+    mbedtls_entropy_context  entropy;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_x509_crt         ca;
+};
+
+MeoTlsClient::MeoTlsClient()
+    : _ctx(nullptr),
+      _caCertPem(nullptr),
+      _storage(nullptr),
+      _logger(nullptr),
+      _handshakeTimeoutMs(10000),
+      _lastHandshakeMs(0),
+      _lastResumed(false),
+      _configured(false),
+      _sslActive(false),
+      _connected(false),
+      _certificateSeen(false),
+      _peeked(-1) {}
+
+MeoTlsClient::~MeoTlsClient() {
+    stop();
+    if (_configured) {
+        mbedtls_x509_crt_free(&_ctx->ca);
+        mbedtls_ssl_config_free(&_ctx->conf);
+        mbedtls_ctr_drbg_free(&_ctx->drbg);
+        mbedtls_entropy_free(&_ctx->entropy);
+    }
+    delete _ctx;
+}
+
+bool MeoTlsClient::begin() {
+    if (!_ctx) {
+        _ctx = new (std::nothrow) MeoTlsContexts;
+        if (!_ctx && _logger) _logger("ERROR", "TLS: out of memory");
+    }
+    return _ctx != nullptr;
+}
+
+void MeoTlsClient::setCACert(const char* caCertPem) {
+    _caCertPem = caCertPem;
+}
+
+void MeoTlsClient::setSessionCache(MeoStorage* storage) {
+    _storage = storage;
+}
+
+void MeoTlsClient::setHandshakeTimeout(unsigned long timeoutMs) {
+    _handshakeTimeoutMs = timeoutMs;
+}
+
+void MeoTlsClient::setLogger(MeoLogFunction logger) {
+    _logger = logger;
+}
+
+int MeoTlsClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port, (int32_t)_handshakeTimeoutMs);
+}
+
+int MeoTlsClient::connect(const char* host, uint16_t port) {
+    return connect(host, port, (int32_t)_handshakeTimeoutMs);
+}
+
+int MeoTlsClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+    return connect(ip.toString().c_str(), port, timeoutMs);
+}
+
+int MeoTlsClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    stop();
+    if (!begin() || !_setupConfig()) {
+        return 0;
+    }
+
+    unsigned long start = millis();
+    if (!_tcp.connect(host, port, timeoutMs)) {
+        if (_logger) _logger("ERROR", "TLS: TCP connect failed");
+        return 0;
+    }
+
+    mbedtls_ssl_init(&_ctx->ssl);
+    _sslActive = true;
+    int ret = mbedtls_ssl_setup(&_ctx->ssl, &_ctx->conf);
+    if (ret == 0) {
+        ret = mbedtls_ssl_set_hostname(&_ctx->ssl, host);   // SNI and certificate name check
+    }
+    if (ret != 0) {
+        _logError("TLS setup failed", ret);
+        stop();
+        return 0;
+    }
+    mbedtls_ssl_set_bio(&_ctx->ssl, &_tcp, _bioSend, _bioRecv, nullptr);
+
+    bool haveOffered = _offerCachedSession();
+    _certificateSeen = false;
+
+    while ((ret = mbedtls_ssl_handshake(&_ctx->ssl)) != 0) {
+        if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+            millis() - start > _handshakeTimeoutMs) {
+            _logError("TLS handshake failed", ret);
+            if (haveOffered && _storage) {
+                _storage->clearTlsSession();   // do not offer it again
+            }
+            stop();
+            return 0;
+        }
+        delay(1);
+    }
+    _lastHandshakeMs = millis() - start;
+    _connected = true;
+
+    // An abbreviated handshake has no Certificate message, so the verify
+    // callback never ran. Comparing session ids is not enough: with tickets the
+    // server may pick a fresh id on a full handshake or echo ours on a resumed one.
+    _lastResumed = haveOffered && !_certificateSeen;
+
+    _saveSession(_lastResumed);
+
+    if (_logger) {
+        String msg = String(_lastResumed ? "TLS session resumed in " : "TLS full handshake in ") +
+                     String(_lastHandshakeMs) + " ms";
+        _logger("INFO", msg.c_str());
+    }
+    return 1;
+}
+
+size_t MeoTlsClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t MeoTlsClient::write(const uint8_t* buf, size_t size) {
+    if (!_connected) {
+        return 0;
+    }
+
+    size_t written = 0;
+    unsigned long start = millis();
+    while (written < size) {
+        int ret = mbedtls_ssl_write(&_ctx->ssl, buf + written, size - written);
+        if (ret > 0) {
+            written += ret;
+        } else if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+                   millis() - start > _handshakeTimeoutMs) {
+            _logError("TLS write failed", ret);
+            _connected = false;
+            break;
+        }
+    }
+    return written;
+}
+
+int MeoTlsClient::available() {
+    if (!_connected) {
+        return 0;
+    }
+
+    // A zero-length read makes mbedtls process any pending record
+    int ret = mbedtls_ssl_read(&_ctx->ssl, nullptr, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        _connected = false;
+    }
+    return (_peeked >= 0 ? 1 : 0) + (int)mbedtls_ssl_get_bytes_avail(&_ctx->ssl);
+}
+
+int MeoTlsClient::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int MeoTlsClient::read(uint8_t* buf, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+
+    int count = 0;
+    if (_peeked >= 0) {
+        buf[count++] = (uint8_t)_peeked;
+        _peeked = -1;
+        if (size == 1) return 1;
+    }
+    if (!_connected) {
+        return count > 0 ? count : -1;
+    }
+
+    int ret = mbedtls_ssl_read(&_ctx->ssl, buf + count, size - count);
+    if (ret > 0) {
+        return count + ret;
+    }
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        _connected = false;   // close_notify, EOF or error
+    }
+    return count > 0 ? count : -1;
+}
+
+int MeoTlsClient::peek() {
+    if (_peeked < 0) {
+        uint8_t b;
+        if (read(&b, 1) == 1) {
+            _peeked = b;
+        }
+    }
+    return _peeked;
+}
+
+void MeoTlsClient::flush() {
+    // writes go out immediately; nothing buffered on our side
+}
+
+void MeoTlsClient::stop() {
+    if (_sslActive && _connected) {
+        mbedtls_ssl_close_notify(&_ctx->ssl);
+    }
+    _connected = false;
+    _peeked = -1;
+    _tcp.stop();
+    _releaseSsl();
+}
+
+uint8_t MeoTlsClient::connected() {
+    if (!_connected) {
+        return 0;
+    }
+    if (!_tcp.connected() && available() == 0) {
+        _connected = false;
+        return 0;
+    }
+    return 1;
+}
+
+bool MeoTlsClient::_setupConfig() {
+    if (_configured) {
+        return true;
+    }
+
+    MeoTlsContexts& c = *_ctx;
+    mbedtls_entropy_init(&c.entropy);
+    mbedtls_ctr_drbg_init(&c.drbg);
+    mbedtls_ssl_config_init(&c.conf);
+    mbedtls_x509_crt_init(&c.ca);
+    _configured = true;
+
+    int ret = mbedtls_ctr_drbg_seed(&c.drbg, mbedtls_entropy_func, &c.entropy,
+                                    (const unsigned char*)MEO_TLS_PERS, strlen(MEO_TLS_PERS));
+    if (ret == 0) {
+        ret = mbedtls_ssl_config_defaults(&c.conf, MBEDTLS_SSL_IS_CLIENT,
+                                          MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (ret != 0) {
+        _logError("TLS config failed", ret);
+    } else if (_caCertPem) {
+        ret = mbedtls_x509_crt_parse(&c.ca, (const unsigned char*)_caCertPem, strlen(_caCertPem) + 1);
+        if (ret != 0) {
+            _logError("TLS CA certificate invalid", ret);
+        } else {
+            mbedtls_ssl_conf_ca_chain(&c.conf, &c.ca, nullptr);
+            mbedtls_ssl_conf_authmode(&c.conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+        }
+    } else {
+        // OPTIONAL rather than NONE: the chain is still parsed and the verify
+        // callback still runs, which tells a full handshake from a resumed one
+        if (_logger) _logger("WARN", "TLS without CA certificate: broker is not verified");
+        mbedtls_ssl_conf_authmode(&c.conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+    }
+
+    if (ret != 0) {
+        // start from scratch on the next connect
+        mbedtls_x509_crt_free(&c.ca);
+        mbedtls_ssl_config_free(&c.conf);
+        mbedtls_ctr_drbg_free(&c.drbg);
+        mbedtls_entropy_free(&c.entropy);
+        _configured = false;
+        return false;
+    }
+
+    mbedtls_ssl_conf_rng(&c.conf, mbedtls_ctr_drbg_random, &c.drbg);
+    mbedtls_ssl_conf_verify(&c.conf, _onVerify, this);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&c.conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+    return true;
+}
+
+bool MeoTlsClient::_offerCachedSession() {
+    if (!_storage) {
+        return false;
+    }
+
+    std::unique_ptr<uint8_t[]> blob(new (std::nothrow) uint8_t[MeoConfig::TLS_SESSION_MAX]);
+    if (!blob) {
+        return false;
+    }
+    size_t len = _storage->loadTlsSession(blob.get(), MeoConfig::TLS_SESSION_MAX);
+    if (len == 0) {
+        return false;
+    }
+
+    // mbedtls_ssl_set_session() copies the session, so it can be freed right away
+    mbedtls_ssl_session offered;
+    mbedtls_ssl_session_init(&offered);
+    bool ok = mbedtls_ssl_session_load(&offered, blob.get(), len) == 0 &&
+              mbedtls_ssl_set_session(&_ctx->ssl, &offered) == 0;
+    mbedtls_ssl_session_free(&offered);
+    if (!ok) {
+        // stale format (e.g. after an mbedtls update): forget it
+        _storage->clearTlsSession();
+    }
+    return ok;
+}
+
+void MeoTlsClient::_saveSession(bool resumed) {
+    if (!_storage) {
+        return;
+    }
+
+    std::unique_ptr<uint8_t[]> blob(new (std::nothrow) uint8_t[MeoConfig::TLS_SESSION_MAX]);
+    if (!blob) {
+        return;
+    }
+    mbedtls_ssl_session current;
+    mbedtls_ssl_session_init(&current);
+    size_t len = 0;
+    int ret = mbedtls_ssl_get_session(&_ctx->ssl, &current);
+    if (ret == 0) {
+        ret = mbedtls_ssl_session_save(&current, blob.get(), MeoConfig::TLS_SESSION_MAX, &len);
+    }
+    mbedtls_ssl_session_free(&current);
+    if (ret != 0) {
+        // MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL: the peer chain does not fit MEO_TLS_SESSION_MAX
+        _logError("TLS session not cached", ret);
+        return;
+    }
+
+    // A resumed handshake may still bring a re-issued ticket; flash is only
+    // written when the session differs from the cached one
+    if (resumed) {
+        std::unique_ptr<uint8_t[]> cached(new (std::nothrow) uint8_t[MeoConfig::TLS_SESSION_MAX]);
+        if (!cached || (_storage->loadTlsSession(cached.get(), MeoConfig::TLS_SESSION_MAX) == len &&
+                        memcmp(cached.get(), blob.get(), len) == 0)) {
+            return;
+        }
+    }
+    if (!_storage->saveTlsSession(blob.get(), len) && _logger) {
+        _logger("WARN", "TLS: session not written to NVS");
+    }
+}
+
+void MeoTlsClient::_releaseSsl() {
+    if (_sslActive) {
+        mbedtls_ssl_free(&_ctx->ssl);
+        _sslActive = false;
+    }
+}
+
+void MeoTlsClient::_logError(const char* what, int ret) {
+    if (!_logger) return;
+
+    char err[64];
+    mbedtls_strerror(ret, err, sizeof(err));
+    String msg = String(what) + ": " + err;
+    _logger("ERROR", msg.c_str());
+}
+
+int MeoTlsClient::_onVerify(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags) {
+    // Called once per certificate of a received Certificate message
+    static_cast<MeoTlsClient*>(ctx)->_certificateSeen = true;
+    return 0;   // keep the verification result in *flags
+}
+
+int MeoTlsClient::_bioSend(void* ctx, const unsigned char* buf, size_t len) {
+    WiFiClient* tcp = static_cast<WiFiClient*>(ctx);
+    int n = tcp->write(buf, len);
+    if (n > 0) {
+        return n;
+    }
+    return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_CONN_RESET;
+}
+
+int MeoTlsClient::_bioRecv(void* ctx, unsigned char* buf, size_t len) {
+    WiFiClient* tcp = static_cast<WiFiClient*>(ctx);
+    if (!tcp->available()) {
+        return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    int n = tcp->read(buf, len);
+    return n > 0 ? n : MBEDTLS_ERR_SSL_WANT_READ;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Meo3_Type.h"
+#include "Meo3_Config.h"
+#include "Meo3_Storage.h"
+#include <WiFiClient.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+
+// TLS transport for PubSubClient (mbedtls over a WiFiClient).
+// Unlike WiFiClientSecure it keeps the negotiated session (session ticket or
+// session id) in MeoStorage and offers it on the next connect, so reconnects
+// and wake-ups from deep sleep do an abbreviated handshake instead of a full one.
+// The mbedtls contexts (about 2 KB) are allocated by begin(), so a device that
+// never calls useTls() does not pay for them.
+struct MeoTlsContexts;
+
+class MeoTlsClient : public Client {
+public:
+    MeoTlsClient();
+    ~MeoTlsClient();
+
+    // Allocates the mbedtls contexts; connect() calls it if needed. False if out of memory.
+    bool begin();
+    // PEM CA used to verify the broker; nullptr disables verification (testing only).
+    // Read on the first connect; the string must stay valid.
+    void setCACert(const char* caCertPem);
+    void setSessionCache(MeoStorage* storage);
+    void setHandshakeTimeout(unsigned long timeoutMs);
+    void setLogger(MeoLogFunction logger);
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs);
+    int connect(const char* host, uint16_t port, int32_t timeoutMs);
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+    unsigned long lastHandshakeMs() const { return _lastHandshakeMs; }
+    bool lastHandshakeResumed() const { return _lastResumed; }
+
+private:
+    WiFiClient      _tcp;
+    MeoTlsContexts* _ctx;          // nullptr until begin()
+    const char*     _caCertPem;
+    MeoStorage*     _storage;
+    MeoLogFunction  _logger;
+    unsigned long   _handshakeTimeoutMs;
+    unsigned long   _lastHandshakeMs;
+    bool            _lastResumed;
+    bool            _configured;   // conf/drbg/ca ready
+    bool            _sslActive;    // ssl set up for the current connection
+    bool            _connected;
+    bool            _certificateSeen;   // server sent a Certificate message (full handshake)
+    int             _peeked;       // -1 if none
+
+    bool _setupConfig();
+    bool _offerCachedSession();
+    void _saveSession(bool resumed);
+    void _releaseSsl();
+    void _logError(const char* what, int ret);
+
+    static int _onVerify(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags);
+    static int _bioSend(void* ctx, const unsigned char* buf, size_t len);
+    static int _bioRecv(void* ctx, unsigned char* buf, size_t len);
+};
@@ -0,0 +1,46 @@
+#include "Meo3_Trace.h"
+
+MeoLatencyHistogram::MeoLatencyHistogram() {
+    reset();
+}
+
+void MeoLatencyHistogram::record(uint32_t us) {
+    uint8_t bucket = 0;
+    while (bucket < BUCKETS - 1 && (us >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    _buckets[bucket]++;
+    _count++;
+    _sumUs += us;
+    if (us > _maxUs) {
+        _maxUs = us;
+    }
+}
+
+void MeoLatencyHistogram::reset() {
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+        _buckets[i] = 0;
+    }
+    _count = 0;
+    _maxUs = 0;
+    _sumUs = 0;
+}
+
+uint32_t MeoLatencyHistogram::percentileUs(uint8_t pct) const {
+    if (_count == 0) {
+        return 0;
+    }
+
+    uint32_t target = (uint32_t)(((uint64_t)_count * pct + 99) / 100);
+    if (target == 0) target = 1;
+
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+        seen += _buckets[i];
+        if (seen >= target) {
+            uint32_t upper = (i == BUCKETS - 1) ? _maxUs : ((uint32_t)2 << i) - 1;
+            return upper < _maxUs ? upper : _maxUs;
+        }
+    }
+    return _maxUs;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Log2-bucketed latency histogram: bucket i counts samples in [2^i, 2^(i+1)) us,
+// the last bucket everything above. Fixed size, no allocation.
+class MeoLatencyHistogram {
+public:
+    static const uint8_t BUCKETS = 24;   // up to ~8 s
+
+    MeoLatencyHistogram();
+
+    void record(uint32_t us);
+    void reset();
+
+    uint32_t count() const { return _count; }
+    uint32_t maxUs() const { return _maxUs; }
+    uint32_t meanUs() const { return _count ? (uint32_t)(_sumUs / _count) : 0; }
+    // Upper bound of the bucket holding the given percentile (0-100)
+    uint32_t percentileUs(uint8_t pct) const;
+    uint32_t bucketCount(uint8_t bucket) const { return bucket < BUCKETS ? _buckets[bucket] : 0; }
+
+private:
+    uint32_t _buckets[BUCKETS];
+    uint32_t _count;
+    uint32_t _maxUs;
+    uint64_t _sumUs;
+};
+
+// Per-stage latency of handled invocations
+struct MeoInvokeStats {
+    MeoLatencyHistogram parse;     // receive -> parsed
+    MeoLatencyHistogram handler;   // handler start -> handler end
+    MeoLatencyHistogram publish;   // response publish call duration
+    MeoLatencyHistogram total;     // receive -> response published
+
+    void reset() {
+        parse.reset();
+        handler.reset();
+        publish.reset();
+        total.reset();
+    }
+};
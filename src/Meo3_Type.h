@@ -25,12 +25,35 @@ struct MeoDeviceInfo {
 // Simple key-value payload type for events/feature params
 using MeoEventPayload = std::map<String, String>;  // later we can switch to ArduinoJson
 
+// micros() timestamps of one invocation's way through the library (0 = not reached)
+struct MeoInvokeTrace {
+    uint32_t receivedUs;       // message handed to us by the transport
+    uint32_t parsedUs;         // topic + JSON parsed
+    uint32_t handlerStartUs;   // user handler called
+    uint32_t handlerEndUs;     // user handler returned
+
+    MeoInvokeTrace() : receivedUs(0), parsedUs(0), handlerStartUs(0), handlerEndUs(0) {}
+};
+
+// Transport an invocation arrived on; its response goes back the same way
+enum class MeoCallOrigin : int {
+    MQTT      = 0,
+    LOCAL_UDP = 1
+};
+
 // Represent a feature invocation from the gateway
 struct MeoFeatureCall {
     String deviceId;
     String featureName;
     MeoEventPayload params;   // raw string values; user can parse as needed
     String requestId;         // if you define correlation IDs
+    MeoInvokeTrace trace;
+
+    MeoCallOrigin origin;
+    IPAddress     replyIp;    // LOCAL_UDP only
+    uint16_t      replyPort;
+
+    MeoFeatureCall() : origin(MeoCallOrigin::MQTT), replyPort(0) {}
 };
 
 // Callback type for feature handlers
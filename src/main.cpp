@@ -44,6 +44,8 @@ void meoLogger(const char* level, const char* message) {
     Serial.println(message);
 }
 
+void generateRandomPayload(MeoEventPayload& payload);
+
 void setup() {
     Serial.begin(115200);
     delay(2000);
@@ -66,6 +68,12 @@ void setup() {
     meo.addFeatureMethod("turn_on_led", onTurnOn);
 
     meo.start();
+
+    meo.every(5000, []() {
+        MeoEventPayload p;
+        generateRandomPayload(p);
+        meo.publishEvent("humid_temp_update", p);
+    });
 }
 
 
@@ -77,13 +85,6 @@ void generateRandomPayload(MeoEventPayload& payload) {
 }
 
 void loop() {
-    meo.loop();
-
-    static unsigned long last = 0;
-    if (millis() - last > 5000) {
-        last = millis();
-        MeoEventPayload p;
-        generateRandomPayload(p);
-        meo.publishEvent("humid_temp_update", p);
-    }
+    uint32_t idleMs = meo.loop();
+    delay(idleMs);   // nothing else to do until the next timer or poll
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+// Minimal Arduino core for the native (host) test environment. Only what the
+// host-testable library parts use; time is simulated and advanced by the tests.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <string>
+#include <algorithm>
+
+// --- Simulated time ---
+inline uint32_t& meoTestClockMs() {
+    static uint32_t ms = 0;
+    return ms;
+}
+inline void meoTestAdvanceMs(uint32_t ms) { meoTestClockMs() += ms; }
+inline void meoTestSetMs(uint32_t ms) { meoTestClockMs() = ms; }
+
+inline unsigned long millis() { return meoTestClockMs(); }
+inline unsigned long micros() { return (unsigned long)meoTestClockMs() * 1000UL; }
+inline void delay(unsigned long ms) { meoTestAdvanceMs(ms); }
+inline void yield() {}
+
+// SNTP is not started on the host; gettimeofday() is the host clock
+inline void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                       const char* server2 = nullptr, const char* server3 = nullptr) {}
+
+inline long random(long howsmall, long howbig) {
+    return howbig > howsmall ? howsmall + rand() % (howbig - howsmall) : howsmall;
+}
+inline long random(long howbig) { return random(0, howbig); }
+
+// --- String ---
+class String {
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int v) : _s(std::to_string(v)) {}
+    explicit String(unsigned int v) : _s(std::to_string(v)) {}
+    explicit String(long v) : _s(std::to_string(v)) {}
+    explicit String(unsigned long v) : _s(std::to_string(v)) {}
+    explicit String(float v) : _s(std::to_string(v)) {}
+    explicit String(double v) : _s(std::to_string(v)) {}
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    bool reserve(unsigned int n) { _s.reserve(n); return true; }
+
+    bool concat(const char* s) { _s += s ? s : ""; return true; }
+    bool concat(const char* s, unsigned int n) { _s.append(s, n); return true; }
+    bool concat(const String& s) { _s += s._s; return true; }
+    bool concat(char c) { _s += c; return true; }
+
+    String& operator+=(const String& s) { _s += s._s; return *this; }
+    String& operator+=(const char* s) { concat(s); return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    String& operator+=(int v) { _s += std::to_string(v); return *this; }
+    String& operator+=(unsigned int v) { _s += std::to_string(v); return *this; }
+    String& operator+=(long v) { _s += std::to_string(v); return *this; }
+    String& operator+=(unsigned long v) { _s += std::to_string(v); return *this; }
+
+    bool operator==(const String& o) const { return _s == o._s; }
+    bool operator==(const char* o) const { return _s == (o ? o : ""); }
+    bool operator!=(const String& o) const { return !(*this == o); }
+    bool operator!=(const char* o) const { return !(*this == o); }
+    bool operator<(const String& o) const { return _s < o._s; }
+    char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : '\0'; }
+
+    int indexOf(char c, unsigned int from = 0) const { return _pos(_s.find(c, from)); }
+    int indexOf(const String& s, unsigned int from = 0) const { return _pos(_s.find(s._s, from)); }
+    String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        return from < to && from < _s.size() ? String(_s.substr(from, to - from)) : String();
+    }
+    bool startsWith(const String& p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+    long toInt() const { return atol(_s.c_str()); }
+    void toLowerCase() { for (auto& c : _s) c = (char)tolower((unsigned char)c); }
+    void trim() {
+        size_t b = _s.find_first_not_of(" \t\r\n");
+        size_t e = _s.find_last_not_of(" \t\r\n");
+        _s = b == std::string::npos ? std::string() : _s.substr(b, e - b + 1);
+    }
+
+private:
+    std::string _s;
+    static int _pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+};
+
+// Type of "a + b" in the Arduino core; ArduinoJson knows it by name
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+};
+
+inline StringSumHelper operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline StringSumHelper operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline StringSumHelper operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+inline StringSumHelper operator+(const String& a, char b) { String r(a); r += b; return r; }
+
+// --- IPAddress ---
+class IPAddress {
+public:
+    IPAddress() : _addr(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _addr((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t addr) : _addr(addr) {}
+
+    operator uint32_t() const { return _addr; }
+    uint8_t operator[](int i) const { return (uint8_t)(_addr >> (8 * i)); }
+    bool operator==(const IPAddress& o) const { return _addr == o._addr; }
+    bool operator!=(const IPAddress& o) const { return _addr != o._addr; }
+
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+        return String(buf);
+    }
+    bool fromString(const char* s) {
+        unsigned a, b, c, d;
+        if (sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+
+private:
+    uint32_t _addr;
+};
+
+// --- Streams ---
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len) {
+        size_t n = 0;
+        while (len--) n += write(*buf++);
+        return n;
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+class Client : public Stream {
+public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char* host, uint16_t port) = 0;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size) = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+    virtual void flush() = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+    virtual operator bool() = 0;
+};
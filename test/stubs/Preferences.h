@@ -0,0 +1,65 @@
+// Native test stub: NVS namespaces kept in memory for the life of the process
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) { _ns = &_store()[name]; return true; }
+    void end() { _ns = nullptr; }
+
+    size_t putString(const char* key, const String& value) {
+        return _put(key, value.c_str(), value.length());
+    }
+    String getString(const char* key, const String& defaultValue = String()) {
+        const std::vector<uint8_t>* v = _get(key);
+        return v ? String(std::string(v->begin(), v->end())) : defaultValue;
+    }
+    size_t putBytes(const char* key, const void* value, size_t len) { return _put(key, value, len); }
+    size_t getBytesLength(const char* key) {
+        const std::vector<uint8_t>* v = _get(key);
+        return v ? v->size() : 0;
+    }
+    size_t getBytes(const char* key, void* buf, size_t maxLen) {
+        const std::vector<uint8_t>* v = _get(key);
+        if (!v || v->size() > maxLen) return 0;
+        memcpy(buf, v->data(), v->size());
+        return v->size();
+    }
+    size_t putUInt(const char* key, uint32_t value) { return _put(key, &value, sizeof(value)); }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) {
+        uint32_t v = defaultValue;
+        return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+    }
+    size_t putULong64(const char* key, uint64_t value) { return _put(key, &value, sizeof(value)); }
+    uint64_t getULong64(const char* key, uint64_t defaultValue = 0) {
+        uint64_t v = defaultValue;
+        return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+    }
+    bool isKey(const char* key) { return _get(key) != nullptr; }
+    bool remove(const char* key) { return _ns && _ns->erase(key) > 0; }
+    bool clear() { if (_ns) _ns->clear(); return _ns != nullptr; }
+
+private:
+    typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+    Namespace* _ns = nullptr;
+
+    static std::map<std::string, Namespace>& _store() {
+        static std::map<std::string, Namespace> store;
+        return store;
+    }
+    size_t _put(const char* key, const void* value, size_t len) {
+        if (!_ns) return 0;
+        const uint8_t* p = static_cast<const uint8_t*>(value);
+        (*_ns)[key].assign(p, p + len);
+        return len;
+    }
+    const std::vector<uint8_t>* _get(const char* key) const {
+        if (!_ns) return nullptr;
+        auto it = _ns->find(key);
+        return it == _ns->end() ? nullptr : &it->second;
+    }
+};
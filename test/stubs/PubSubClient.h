@@ -0,0 +1,52 @@
+// Native test stub: an MQTT client whose broker is never reachable. The
+// library's invoke path is driven through MeoMqttClient::dispatchFeatureCall().
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_KEEPALIVE 15
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient {
+public:
+    PubSubClient() : _bufferSize(MQTT_MAX_PACKET_SIZE) {}
+    explicit PubSubClient(Client& client) : _bufferSize(MQTT_MAX_PACKET_SIZE) {}
+
+    PubSubClient& setServer(const char* host, uint16_t port) { return *this; }
+    PubSubClient& setServer(IPAddress ip, uint16_t port) { return *this; }
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE) { return *this; }
+    PubSubClient& setClient(Client& client) { return *this; }
+    PubSubClient& setKeepAlive(uint16_t seconds) { return *this; }
+    PubSubClient& setSocketTimeout(uint16_t seconds) { return *this; }
+    bool setBufferSize(uint16_t size) { _bufferSize = size; return true; }
+    uint16_t getBufferSize() { return _bufferSize; }
+
+    bool connect(const char* id) { return false; }
+    bool connect(const char* id, const char* user, const char* pass) { return false; }
+    bool connect(const char* id, const char* user, const char* pass, const char* willTopic,
+                 uint8_t willQos, bool willRetain, const char* willMessage, bool cleanSession) {
+        return false;
+    }
+    void disconnect() {}
+
+    bool publish(const char* topic, const char* payload) { return false; }
+    bool publish(const char* topic, const char* payload, bool retained) { return false; }
+    bool publish(const char* topic, const uint8_t* payload, unsigned int len) { return false; }
+    bool publish(const char* topic, const uint8_t* payload, unsigned int len, bool retained) { return false; }
+    bool beginPublish(const char* topic, unsigned int len, bool retained) { return false; }
+    int endPublish() { return 0; }
+    size_t write(uint8_t c) { return 0; }
+    size_t write(const uint8_t* buf, size_t len) { return 0; }
+
+    bool subscribe(const char* topic) { return false; }
+    bool subscribe(const char* topic, uint8_t qos) { return false; }
+    bool unsubscribe(const char* topic) { return false; }
+    bool loop() { return false; }
+    bool connected() { return false; }
+    int state() { return -1; }
+
+private:
+    uint16_t _bufferSize;
+};
@@ -0,0 +1,16 @@
+// Native test stub: there is no OTA partition on the host, use MeoFileSink
+#pragma once
+
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+class UpdateClass {
+public:
+    bool begin(size_t size) { return false; }
+    size_t write(uint8_t* data, size_t len) { return 0; }
+    bool end(bool evenIfRemaining = false) { return false; }
+    void abort() {}
+};
+
+static UpdateClass Update;
@@ -0,0 +1,21 @@
+// Native test stub: a station that never joins a network
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiServer.h>
+#include <WiFiUdp.h>
+
+enum wl_status_t { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 };
+
+class WiFiClass {
+public:
+    wl_status_t status() const { return WL_DISCONNECTED; }
+    IPAddress localIP() const { return IPAddress(192, 168, 1, 50); }
+    IPAddress subnetMask() const { return IPAddress(255, 255, 255, 0); }
+    IPAddress gatewayIP() const { return IPAddress(192, 168, 1, 1); }
+    String macAddress() const { return String("02:00:00:00:00:01"); }
+    int hostByName(const char* host, IPAddress& out) { return out.fromString(host) ? 1 : 0; }
+};
+
+static WiFiClass WiFi;
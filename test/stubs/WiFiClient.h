@@ -0,0 +1,23 @@
+// Native test stub: a client that is never connected
+#pragma once
+
+#include <Arduino.h>
+
+class WiFiClient : public Client {
+public:
+    int connect(IPAddress ip, uint16_t port) override { return 0; }
+    int connect(const char* host, uint16_t port) override { return 0; }
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs) { return 0; }
+    int connect(const char* host, uint16_t port, int32_t timeoutMs) { return 0; }
+    size_t write(uint8_t c) override { return 0; }
+    size_t write(const uint8_t* buf, size_t size) override { return 0; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int read(uint8_t* buf, size_t size) override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+    void stop() override {}
+    uint8_t connected() override { return 0; }
+    operator bool() override { return false; }
+    IPAddress remoteIP() const { return IPAddress(); }
+};
@@ -0,0 +1,12 @@
+// Native test stub: a listener nobody connects to
+#pragma once
+
+#include <WiFiClient.h>
+
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t port) {}
+    void begin() {}
+    void stop() {}
+    WiFiClient available() { return WiFiClient(); }
+};
@@ -0,0 +1,58 @@
+// Native test stub: sent datagrams are dropped; tests queue incoming ones
+// with meoTestUdpInject()
+#pragma once
+
+#include <Arduino.h>
+#include <deque>
+#include <vector>
+
+struct MeoTestDatagram {
+    std::vector<uint8_t> data;
+    IPAddress ip;
+    uint16_t port;
+};
+
+inline std::deque<MeoTestDatagram>& meoTestUdpQueue() {
+    static std::deque<MeoTestDatagram> queue;
+    return queue;
+}
+
+inline void meoTestUdpInject(const uint8_t* data, size_t len, IPAddress ip, uint16_t port) {
+    meoTestUdpQueue().push_back(MeoTestDatagram{std::vector<uint8_t>(data, data + len), ip, port});
+}
+
+class WiFiUDP : public Stream {
+public:
+    uint8_t begin(uint16_t port) { return 1; }
+    void stop() {}
+    int beginPacket(IPAddress ip, uint16_t port) { return 1; }
+    int endPacket() { return 1; }
+    size_t write(uint8_t c) override { return 1; }
+    size_t write(const uint8_t* buf, size_t len) override { return len; }
+    int parsePacket() {
+        if (meoTestUdpQueue().empty()) {
+            return 0;
+        }
+        _current = meoTestUdpQueue().front();
+        meoTestUdpQueue().pop_front();
+        _pos = 0;
+        return (int)_current.data.size();
+    }
+    int available() override { return (int)(_current.data.size() - _pos); }
+    int read() override { return available() > 0 ? _current.data[_pos++] : -1; }
+    int read(uint8_t* buf, size_t len) {
+        size_t n = std::min(len, (size_t)available());
+        memcpy(buf, _current.data.data() + _pos, n);
+        _pos += n;
+        return (int)n;
+    }
+    int read(char* buf, size_t len) { return read((uint8_t*)buf, len); }
+    int peek() override { return available() > 0 ? _current.data[_pos] : -1; }
+    void flush() { _pos = _current.data.size(); }
+    IPAddress remoteIP() const { return _current.ip; }
+    uint16_t remotePort() const { return _current.port; }
+
+private:
+    MeoTestDatagram _current{};
+    size_t _pos = 0;
+};
@@ -0,0 +1,186 @@
+// MeoLzssEncoder against a reference decoder: round trips for every window
+// size, edge-case inputs, and a host benchmark of ratio and throughput.
+#include <unity.h>
+#include <Meo3_Compress.h>
+#include <chrono>
+#include <vector>
+
+// Decodes the stream format documented in Meo3_Compress.h
+static std::vector<uint8_t> lzssDecode(const std::vector<uint8_t>& in, uint8_t windowBits) {
+    const uint8_t lengthBits = 16 - windowBits;
+    std::vector<uint8_t> out;
+    size_t i = 0;
+    while (i < in.size()) {
+        uint8_t flags = in[i++];
+        for (int item = 0; item < 8 && i < in.size(); item++) {
+            if (flags & (1 << item)) {
+                out.push_back(in[i++]);
+                continue;
+            }
+            TEST_ASSERT_TRUE(i + 2 <= in.size());
+            uint16_t token = (uint16_t)((in[i] << 8) | in[i + 1]);
+            i += 2;
+            size_t offset = (size_t)(token >> lengthBits) + 1;
+            size_t length = (size_t)(token & ((1 << lengthBits) - 1)) + MEO_LZSS_MIN_MATCH;
+            TEST_ASSERT_TRUE(offset <= out.size());
+            TEST_ASSERT_TRUE(offset <= ((size_t)1 << windowBits));
+            for (size_t k = 0; k < length; k++) {
+                out.push_back(out[out.size() - offset]);   // may overlap the bytes being written
+            }
+        }
+    }
+    return out;
+}
+
+static std::vector<uint8_t> lzssEncode(const std::vector<uint8_t>& data, uint8_t windowBits,
+                                       size_t writeSize) {
+    std::vector<uint8_t> packed;
+    MeoLzssEncoder encoder;
+    TEST_ASSERT_TRUE(encoder.begin(windowBits, [&packed](const uint8_t* p, size_t len) {
+        packed.insert(packed.end(), p, p + len);
+        return true;
+    }));
+    for (size_t off = 0; off < data.size(); off += writeSize) {
+        size_t len = std::min(writeSize, data.size() - off);
+        TEST_ASSERT_TRUE(encoder.write(data.data() + off, len));
+    }
+    TEST_ASSERT_TRUE(encoder.finish());
+    TEST_ASSERT_EQUAL_size_t(data.size(), encoder.bytesIn());
+    TEST_ASSERT_EQUAL_size_t(packed.size(), encoder.bytesOut());
+    return packed;
+}
+
+// Every window size, written in one piece and in odd-sized pieces
+static void roundTrip(const std::vector<uint8_t>& data) {
+    const size_t writeSizes[] = {1, 7, 1000, data.size() + 1};
+    for (uint8_t bits = MEO_LZSS_MIN_WINDOW_BITS; bits <= MEO_LZSS_MAX_WINDOW_BITS; bits++) {
+        for (size_t writeSize : writeSizes) {
+            std::vector<uint8_t> packed = lzssEncode(data, bits, writeSize);
+            TEST_ASSERT_TRUE(lzssDecode(packed, bits) == data);
+        }
+    }
+}
+
+// Sensor log lines, the kind of data the bulk channel carries
+static std::vector<uint8_t> sampleLog(size_t size) {
+    std::vector<uint8_t> data;
+    char line[96];
+    for (uint32_t i = 0; data.size() < size; i++) {
+        int len = snprintf(line, sizeof(line), "%lu,temperature=%d.%d,humidity=%d.%d,rssi=-%d\n",
+                           (unsigned long)(1700000000UL + i * 5), 21 + (int)(i % 7) / 3, (int)(i * 7 % 10),
+                           45 + (int)(i % 11), (int)(i * 3 % 10), 60 + (int)(i % 9));
+        data.insert(data.end(), line, line + len);
+    }
+    data.resize(size);
+    return data;
+}
+
+static std::vector<uint8_t> noise(size_t size) {
+    std::vector<uint8_t> data(size);
+    uint32_t x = 0x12345678;
+    for (auto& b : data) {
+        x = x * 1664525UL + 1013904223UL;
+        b = (uint8_t)(x >> 24);
+    }
+    return data;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_empty_input() {
+    std::vector<uint8_t> empty;
+    for (uint8_t bits = MEO_LZSS_MIN_WINDOW_BITS; bits <= MEO_LZSS_MAX_WINDOW_BITS; bits++) {
+        TEST_ASSERT_EQUAL_size_t(0, lzssEncode(empty, bits, 1).size());
+    }
+    // Inputs shorter than a match
+    roundTrip(std::vector<uint8_t>{'a'});
+    roundTrip(std::vector<uint8_t>{'a', 'b'});
+    roundTrip(std::vector<uint8_t>{'a', 'a', 'a'});
+}
+
+void test_text_round_trip_beyond_the_window() {
+    // Several windows long, so the ring buffer wraps many times
+    roundTrip(sampleLog(20000));
+}
+
+void test_incompressible_input() {
+    std::vector<uint8_t> data = noise(5000);
+    roundTrip(data);
+    // Worst case is one flag byte per 8 literals
+    std::vector<uint8_t> packed = lzssEncode(data, MEO_LZSS_MAX_WINDOW_BITS, data.size());
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(data.size() + (data.size() + 7) / 8, packed.size());
+}
+
+void test_max_match_length() {
+    for (uint8_t bits = MEO_LZSS_MIN_WINDOW_BITS; bits <= MEO_LZSS_MAX_WINDOW_BITS; bits++) {
+        size_t maxMatch = MEO_LZSS_MIN_MATCH + ((size_t)1 << (16 - bits)) - 1;
+
+        // A run: one literal, then back-references of maximum length
+        std::vector<uint8_t> run(1 + 5 * maxMatch, 'x');
+        std::vector<uint8_t> packed = lzssEncode(run, bits, 13);
+        TEST_ASSERT_TRUE(lzssDecode(packed, bits) == run);
+        TEST_ASSERT_EQUAL_size_t(1 + 1 + 5 * 2, packed.size());
+
+        // Runs of exactly maxMatch, maxMatch - 1 and maxMatch + 1 bytes after a prefix
+        for (size_t extra = 0; extra < 3; extra++) {
+            std::vector<uint8_t> data = noise(50);
+            data.insert(data.end(), maxMatch - 1 + extra, 'y');
+            data.insert(data.end(), data.begin(), data.begin() + 50);   // repeat of the prefix
+            std::vector<uint8_t> p = lzssEncode(data, bits, 64);
+            TEST_ASSERT_TRUE(lzssDecode(p, bits) == data);
+        }
+    }
+}
+
+void test_invalid_window_and_sink_abort() {
+    MeoLzssEncoder encoder;
+    auto sink = [](const uint8_t*, size_t) { return true; };
+    TEST_ASSERT_FALSE(encoder.begin(MEO_LZSS_MIN_WINDOW_BITS - 1, sink));
+    TEST_ASSERT_FALSE(encoder.begin(MEO_LZSS_MAX_WINDOW_BITS + 1, sink));
+    TEST_ASSERT_FALSE(encoder.write((const uint8_t*)"abc", 3));
+
+    int calls = 0;
+    TEST_ASSERT_TRUE(encoder.begin(10, [&calls](const uint8_t*, size_t) { return ++calls < 2; }));
+    std::vector<uint8_t> data = noise(4000);
+    bool ok = encoder.write(data.data(), data.size());
+    TEST_ASSERT_FALSE(ok && encoder.finish());
+    TEST_ASSERT_EQUAL_INT(2, calls);   // nothing is sent after the sink refused
+}
+
+void test_crc32_check_value() {
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, meoCrc32((const uint8_t*)"123456789", 9));
+    // Chainable
+    uint32_t crc = meoCrc32((const uint8_t*)"12345", 5);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, meoCrc32((const uint8_t*)"6789", 4, crc));
+}
+
+// Reports ratio and host throughput per window size; only the ratio is checked
+void test_ratio_and_throughput() {
+    std::vector<uint8_t> data = sampleLog(64 * 1024);
+    char msg[128];
+    for (uint8_t bits = MEO_LZSS_MIN_WINDOW_BITS; bits <= MEO_LZSS_MAX_WINDOW_BITS; bits++) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<uint8_t> packed = lzssEncode(data, bits, 256);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        double ratio = (double)packed.size() / data.size();
+        snprintf(msg, sizeof(msg), "window %u B: ratio %.3f, %.0f KB/s", 1u << bits, ratio,
+                 data.size() / 1024.0 / (seconds > 0 ? seconds : 1e-9));
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(ratio < 0.6);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_input);
+    RUN_TEST(test_text_round_trip_beyond_the_window);
+    RUN_TEST(test_incompressible_input);
+    RUN_TEST(test_max_match_length);
+    RUN_TEST(test_invalid_window_and_sink_abort);
+    RUN_TEST(test_crc32_check_value);
+    RUN_TEST(test_ratio_and_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,139 @@
+// MeoLocalControl replay protection: signed datagrams from several senders
+// whose clocks (and therefore seq values) are far apart.
+#include <unity.h>
+#include <Meo3_LocalControl.h>
+#include <mbedtls/md.h>
+#include <vector>
+
+static const uint64_t EPOCH_MS = 1700000000000ULL;
+static const char*    KEY      = "transmit-key";
+
+static MeoClock clock;
+static MeoLocalControl* local;
+static std::vector<String> handled;
+
+// Signs and queues one request, then lets the device process it
+static void send(const char* sender, uint64_t seq, const char* requestId,
+                 IPAddress ip = IPAddress(192, 168, 1, 2), const char* key = KEY) {
+    char body[256];
+    int len;
+    if (sender) {
+        len = snprintf(body, sizeof(body),
+                       "{\"feature\":\"toggle\",\"request_id\":\"%s\",\"sender\":\"%s\",\"seq\":%llu}",
+                       requestId, sender, (unsigned long long)seq);
+    } else {
+        len = snprintf(body, sizeof(body), "{\"feature\":\"toggle\",\"request_id\":\"%s\",\"seq\":%llu}",
+                       requestId, (unsigned long long)seq);
+    }
+
+    uint8_t datagram[MeoConfig::LOCAL_MAC_LEN + sizeof(body)];
+    memcpy(datagram + MeoConfig::LOCAL_MAC_LEN, body, len);
+    TEST_ASSERT_EQUAL_INT(0, mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                                             (const unsigned char*)key, strlen(key),
+                                             (const unsigned char*)body, len, datagram));
+    meoTestUdpInject(datagram, MeoConfig::LOCAL_MAC_LEN + len, ip, 40000);
+    local->loop();
+}
+
+static bool wasHandled(const char* requestId) {
+    for (const String& id : handled) {
+        if (id == requestId) return true;
+    }
+    return false;
+}
+
+void setUp() {
+    meoTestSetMs(60000);   // booted a minute ago
+    clock.syncTo(EPOCH_MS);
+    handled.clear();
+    local = new MeoLocalControl();
+    local->configure("dev-1", KEY, &clock);
+    local->setDispatcher([](MeoFeatureCall& call) { handled.push_back(call.requestId); });
+    TEST_ASSERT_TRUE(local->begin(8902));
+}
+
+void tearDown() {
+    delete local;
+}
+
+void test_two_interleaved_senders_are_both_accepted() {
+    // Gateway B's clock is 500 ms behind A's: with a single window every one
+    // of B's datagrams would be more than 64 entries older than A's latest
+    char id[16];
+    for (int i = 0; i < 10; i++) {
+        snprintf(id, sizeof(id), "a-%d", i);
+        send("gw-a", EPOCH_MS + i * 20, id);
+        snprintf(id, sizeof(id), "b-%d", i);
+        send("gw-b", EPOCH_MS - 500 + i * 20, id, IPAddress(192, 168, 1, 3));
+        meoTestAdvanceMs(20);
+    }
+    TEST_ASSERT_EQUAL_size_t(20, handled.size());
+
+    // Each window still catches replays of its own sender
+    send("gw-a", EPOCH_MS + 100, "a-replay");
+    send("gw-b", EPOCH_MS - 500 + 100, "b-replay", IPAddress(192, 168, 1, 3));
+    TEST_ASSERT_EQUAL_size_t(20, handled.size());
+}
+
+void test_reordering_within_a_sender() {
+    // Far more than 64 ms apart: the window counts datagrams, not milliseconds
+    send("gw-a", EPOCH_MS + 5000, "late");
+    send("gw-a", EPOCH_MS + 100, "early");   // arrives after a newer one
+    send("gw-a", EPOCH_MS + 100, "early-again");
+    TEST_ASSERT_TRUE(wasHandled("late"));
+    TEST_ASSERT_TRUE(wasHandled("early"));
+    TEST_ASSERT_FALSE(wasHandled("early-again"));
+
+    // Once a full window of newer datagrams arrived, older seq values count as seen
+    for (int i = 1; i <= MeoConfig::LOCAL_REPLAY_WINDOW; i++) {
+        send("gw-a", EPOCH_MS + 5000 + i, "newer");
+    }
+    send("gw-a", EPOCH_MS + 200, "too-old");
+    TEST_ASSERT_FALSE(wasHandled("too-old"));
+}
+
+void test_replay_from_another_address_is_rejected() {
+    // The window follows the signed sender name, not the source address
+    send("gw-a", EPOCH_MS, "first");
+    send("gw-a", EPOCH_MS, "spoofed", IPAddress(10, 0, 0, 66));
+    TEST_ASSERT_EQUAL_size_t(1, handled.size());
+
+    // Without a sender name all datagrams share one window
+    send(nullptr, EPOCH_MS + 5, "anonymous");
+    send(nullptr, EPOCH_MS + 5, "anonymous-replay", IPAddress(10, 0, 0, 66));
+    TEST_ASSERT_TRUE(wasHandled("anonymous"));
+    TEST_ASSERT_FALSE(wasHandled("anonymous-replay"));
+}
+
+void test_evicted_sender_cannot_be_replayed() {
+    send("gw-0", EPOCH_MS, "gw-0-first");
+    for (int i = 1; i <= MeoConfig::LOCAL_SENDERS; i++) {
+        char sender[8];
+        snprintf(sender, sizeof(sender), "gw-%d", i);
+        send(sender, EPOCH_MS + i * 1000, sender);   // the last one pushes gw-0 out
+    }
+    TEST_ASSERT_EQUAL_size_t(1 + MeoConfig::LOCAL_SENDERS, handled.size());
+
+    send("gw-0", EPOCH_MS, "gw-0-replay");
+    TEST_ASSERT_FALSE(wasHandled("gw-0-replay"));
+
+    // Newer datagrams of the evicted sender get a fresh window
+    send("gw-0", EPOCH_MS + 10000, "gw-0-later");
+    TEST_ASSERT_TRUE(wasHandled("gw-0-later"));
+}
+
+void test_bad_signature_and_stale_seq_are_rejected() {
+    send("gw-a", EPOCH_MS, "wrong-key", IPAddress(192, 168, 1, 2), "other-key");
+    send("gw-a", EPOCH_MS - 31000, "skewed");
+    TEST_ASSERT_EQUAL_size_t(0, handled.size());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_two_interleaved_senders_are_both_accepted);
+    RUN_TEST(test_reordering_within_a_sender);
+    RUN_TEST(test_replay_from_another_address_is_rejected);
+    RUN_TEST(test_evicted_sender_cannot_be_replayed);
+    RUN_TEST(test_bad_signature_and_stale_seq_are_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,110 @@
+// MeoMqttClient invoke dispatch without a broker: duplicate request ids and
+// the OTA opt-in.
+#include <unity.h>
+#include <Meo3_Mqtt.h>
+
+static MeoFeatureRegistry features;
+static int toggles;
+
+static MeoFeatureCall invoke(const char* feature, const char* requestId) {
+    MeoFeatureCall call;
+    call.deviceId = "dev-1";
+    call.featureName = feature;
+    call.requestId = requestId;
+    return call;
+}
+
+void setUp() {
+    meoTestSetMs(0);
+    toggles = 0;
+    features = MeoFeatureRegistry();
+    features.methodHandlers["toggle"] = [](const MeoFeatureCall&) { toggles++; };
+}
+
+void tearDown() {}
+
+void test_clean_session_runs_a_repeated_request_id_twice() {
+    // Attached but not listening, as MeoDevice does without enableLocalControl()
+    MeoLocalControl local;
+    MeoMqttClient client;
+    client.setLocalControl(&local);
+    client.configure("gateway.local", 1883, "dev-1", "key", &features);
+
+    MeoFeatureCall first = invoke("toggle", "req-1");
+    MeoFeatureCall again = invoke("toggle", "req-1");
+    client.dispatchFeatureCall(first);
+    client.dispatchFeatureCall(again);
+    TEST_ASSERT_EQUAL_INT(2, toggles);
+}
+
+void test_persistent_session_drops_a_redelivered_request_id() {
+    MeoMqttClient client;
+    client.setPersistentSession(true);
+    client.configure("gateway.local", 1883, "dev-1", "key", &features);
+
+    MeoFeatureCall first = invoke("toggle", "req-1");
+    MeoFeatureCall again = invoke("toggle", "req-1");
+    MeoFeatureCall other = invoke("toggle", "req-2");
+    client.dispatchFeatureCall(first);
+    client.dispatchFeatureCall(again);
+    client.dispatchFeatureCall(other);
+    TEST_ASSERT_EQUAL_INT(2, toggles);
+}
+
+void test_listening_local_control_drops_the_second_path() {
+    MeoClock clock;
+    MeoLocalControl local;
+    local.configure("dev-1", "key", &clock);
+    TEST_ASSERT_TRUE(local.begin(8902));
+
+    MeoMqttClient client;
+    client.setLocalControl(&local);
+    client.configure("gateway.local", 1883, "dev-1", "key", &features);
+
+    MeoFeatureCall viaUdp = invoke("toggle", "req-1");
+    viaUdp.origin = MeoCallOrigin::LOCAL_UDP;
+    MeoFeatureCall viaMqtt = invoke("toggle", "req-1");
+    client.dispatchFeatureCall(viaUdp);
+    client.dispatchFeatureCall(viaMqtt);
+    TEST_ASSERT_EQUAL_INT(1, toggles);
+
+    // Without an id there is nothing to match on
+    MeoFeatureCall anonymous = invoke("toggle", "");
+    MeoFeatureCall anonymousAgain = invoke("toggle", "");
+    client.dispatchFeatureCall(anonymous);
+    client.dispatchFeatureCall(anonymousAgain);
+    TEST_ASSERT_EQUAL_INT(3, toggles);
+}
+
+void test_ota_is_off_until_enabled() {
+    const char* imagePath = "meo_test_mqtt_ota.bin";
+    MeoMqttClient client;
+    client.configure("gateway.local", 1883, "dev-1", "key", &features);
+    client.setOtaAllowUnsigned(true);
+    TEST_ASSERT_FALSE(client.isOtaEnabled());
+
+    MeoFeatureCall begin = invoke("_ota", "req-1");
+    begin.params["action"] = "begin";
+    begin.params["size"] = "100";
+    begin.params["sha256"] = String(std::string(64, '0'));
+    client.dispatchFeatureCall(begin);
+    TEST_ASSERT_EQUAL_INT((int)MeoOtaState::IDLE, (int)client.otaState());
+
+    MeoFileSink sink(imagePath);
+    client.setOtaSink(&sink);   // opting in
+    TEST_ASSERT_TRUE(client.isOtaEnabled());
+    MeoFeatureCall again = invoke("_ota", "req-2");
+    again.params = begin.params;
+    client.dispatchFeatureCall(again);
+    TEST_ASSERT_EQUAL_INT((int)MeoOtaState::RECEIVING, (int)client.otaState());
+    remove(imagePath);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_clean_session_runs_a_repeated_request_id_twice);
+    RUN_TEST(test_persistent_session_drops_a_redelivered_request_id);
+    RUN_TEST(test_listening_local_control_drops_the_second_path);
+    RUN_TEST(test_ota_is_off_until_enabled);
+    return UNITY_END();
+}
@@ -0,0 +1,192 @@
+// MeoOtaUpdater against a file-backed sink: chunk ordering, resume, integrity.
+#include <unity.h>
+#include <Meo3_Ota.h>
+#include <vector>
+
+#define ASSERT_ENUM(expected, actual) TEST_ASSERT_EQUAL_INT((int)(expected), (int)(actual))
+
+static const char* IMAGE_PATH = "meo_test_ota.bin";
+static const size_t CHUNK = 100;
+
+static std::vector<uint8_t> image;
+static String imageSha;
+
+static String sha256Hex(const std::vector<uint8_t>& data) {
+    uint8_t digest[32];
+    mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), data.data(), data.size(), digest);
+    char hex[65];
+    for (int i = 0; i < 32; i++) {
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+    return String(hex);
+}
+
+static MeoOtaChunkResult sendChunk(MeoOtaUpdater& ota, uint32_t seq) {
+    size_t offset = seq * CHUNK;
+    size_t len = std::min(CHUNK, image.size() - offset);
+    return ota.writeChunk(seq, image.data() + offset, len);
+}
+
+static uint32_t chunkCount() {
+    return (image.size() + CHUNK - 1) / CHUNK;
+}
+
+static std::vector<uint8_t> readFile(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return data;
+    }
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        data.push_back((uint8_t)c);
+    }
+    fclose(f);
+    return data;
+}
+
+void setUp() {
+    image.resize(1050);   // last chunk is partial
+    for (size_t i = 0; i < image.size(); i++) {
+        image[i] = (uint8_t)(i * 31 + 7);
+    }
+    imageSha = sha256Hex(image);
+    remove(IMAGE_PATH);
+}
+
+void tearDown() {
+    remove(IMAGE_PATH);
+}
+
+void test_chunks_in_order_are_committed() {
+    MeoFileSink sink(IMAGE_PATH);
+    MeoOtaUpdater ota;
+    ota.setSink(&sink);
+    ota.setAllowUnsigned(true);
+
+    TEST_ASSERT_TRUE(ota.begin(image.size(), imageSha, CHUNK));
+    for (uint32_t seq = 0; seq < chunkCount(); seq++) {
+        ASSERT_ENUM(MeoOtaChunkResult::ACCEPTED, sendChunk(ota, seq));
+    }
+
+    String error;
+    TEST_ASSERT_TRUE(ota.finish(error));
+    ASSERT_ENUM(MeoOtaState::DONE, ota.state());
+    TEST_ASSERT_TRUE(readFile(IMAGE_PATH) == image);
+}
+
+void test_gap_and_duplicate_are_not_written() {
+    MeoFileSink sink(IMAGE_PATH);
+    MeoOtaUpdater ota;
+    ota.setSink(&sink);
+    ota.setAllowUnsigned(true);
+
+    TEST_ASSERT_TRUE(ota.begin(image.size(), imageSha, CHUNK));
+    ASSERT_ENUM(MeoOtaChunkResult::ACCEPTED, sendChunk(ota, 0));
+    ASSERT_ENUM(MeoOtaChunkResult::OUT_OF_ORDER, sendChunk(ota, 2));
+    ASSERT_ENUM(MeoOtaChunkResult::DUPLICATE, sendChunk(ota, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, ota.nextSeq());
+    TEST_ASSERT_EQUAL_UINT32(CHUNK, sink.written());
+
+    String error;
+    TEST_ASSERT_FALSE(ota.finish(error));   // incomplete: transfer stays open
+    ASSERT_ENUM(MeoOtaState::RECEIVING, ota.state());
+}
+
+void test_resume_from_next_seq_after_lost_chunks() {
+    MeoFileSink sink(IMAGE_PATH);
+    MeoOtaUpdater ota;
+    ota.setSink(&sink);
+    ota.setAllowUnsigned(true);
+
+    TEST_ASSERT_TRUE(ota.begin(image.size(), imageSha, CHUNK));
+    for (uint32_t seq = 0; seq < 4; seq++) {
+        sendChunk(ota, seq);
+    }
+    // chunks 4 and 5 were lost with the connection; 6 arrives after the reconnect
+    ASSERT_ENUM(MeoOtaChunkResult::OUT_OF_ORDER, sendChunk(ota, 6));
+
+    // "_ota" action=status reports nextSeq(); the sender resumes from there
+    uint32_t resumeAt = ota.nextSeq();
+    TEST_ASSERT_EQUAL_UINT32(4, resumeAt);
+    TEST_ASSERT_EQUAL_UINT32(4 * CHUNK, ota.received());
+    for (uint32_t seq = resumeAt; seq < chunkCount(); seq++) {
+        ASSERT_ENUM(MeoOtaChunkResult::ACCEPTED, sendChunk(ota, seq));
+    }
+
+    String error;
+    TEST_ASSERT_TRUE(ota.finish(error));
+    TEST_ASSERT_TRUE(readFile(IMAGE_PATH) == image);
+}
+
+void test_sha_mismatch_aborts() {
+    MeoFileSink sink(IMAGE_PATH);
+    MeoOtaUpdater ota;
+    ota.setSink(&sink);
+    ota.setAllowUnsigned(true);
+
+    String wrongSha = (imageSha[0] == '0' ? "1" : "0") + imageSha.substring(1);
+    TEST_ASSERT_TRUE(ota.begin(image.size(), wrongSha, CHUNK));
+    for (uint32_t seq = 0; seq < chunkCount(); seq++) {
+        sendChunk(ota, seq);
+    }
+
+    String error;
+    TEST_ASSERT_FALSE(ota.finish(error));
+    TEST_ASSERT_EQUAL_STRING("sha256 mismatch", error.c_str());
+    ASSERT_ENUM(MeoOtaState::FAILED, ota.state());
+    TEST_ASSERT_TRUE(readFile(IMAGE_PATH).empty());   // partial image removed
+    ASSERT_ENUM(MeoOtaChunkResult::REJECTED, sendChunk(ota, 0));
+}
+
+void test_unsigned_image_refused_by_default() {
+    MeoFileSink sink(IMAGE_PATH);
+    MeoOtaUpdater ota;
+    ota.setSink(&sink);
+
+    TEST_ASSERT_FALSE(ota.begin(image.size(), imageSha, CHUNK));
+    ASSERT_ENUM(MeoOtaState::IDLE, ota.state());
+    ASSERT_ENUM(MeoOtaChunkResult::REJECTED, sendChunk(ota, 0));
+    TEST_ASSERT_TRUE(readFile(IMAGE_PATH).empty());   // the sink was never opened
+}
+
+void test_unsigned_image_not_committed_after_policy_change() {
+    MeoFileSink sink(IMAGE_PATH);
+    MeoOtaUpdater ota;
+    ota.setSink(&sink);
+    ota.setAllowUnsigned(true);
+
+    TEST_ASSERT_TRUE(ota.begin(image.size(), imageSha, CHUNK));
+    for (uint32_t seq = 0; seq < chunkCount(); seq++) {
+        sendChunk(ota, seq);
+    }
+    ota.setAllowUnsigned(false);
+
+    String error;
+    TEST_ASSERT_FALSE(ota.finish(error));
+    TEST_ASSERT_EQUAL_STRING("unsigned image", error.c_str());
+    ASSERT_ENUM(MeoOtaState::FAILED, ota.state());
+    TEST_ASSERT_TRUE(readFile(IMAGE_PATH).empty());
+}
+
+void test_unsigned_image_refused_when_key_set() {
+    MeoFileSink sink(IMAGE_PATH);
+    MeoOtaUpdater ota;
+    ota.setSink(&sink);
+    ota.setPublicKey("-----BEGIN PUBLIC KEY-----\n-----END PUBLIC KEY-----\n");
+
+    TEST_ASSERT_FALSE(ota.begin(image.size(), imageSha, CHUNK));
+    ASSERT_ENUM(MeoOtaChunkResult::REJECTED, sendChunk(ota, 0));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_chunks_in_order_are_committed);
+    RUN_TEST(test_gap_and_duplicate_are_not_written);
+    RUN_TEST(test_resume_from_next_seq_after_lost_chunks);
+    RUN_TEST(test_sha_mismatch_aborts);
+    RUN_TEST(test_unsigned_image_refused_by_default);
+    RUN_TEST(test_unsigned_image_not_committed_after_policy_change);
+    RUN_TEST(test_unsigned_image_refused_when_key_set);
+    return UNITY_END();
+}
@@ -0,0 +1,155 @@
+// MeoRegistrationClient building blocks: schema hash and delta, retransmission
+// schedule, page packing of the discovery datagrams.
+#include <unity.h>
+#include <Meo3_Registration.h>
+#include <ArduinoJson.h>
+#include <set>
+#include <vector>
+
+static MeoFeatureRegistry makeFeatures(const std::vector<const char*>& events,
+                                       const std::vector<const char*>& methods) {
+    MeoFeatureRegistry features;
+    for (const char* e : events) {
+        features.eventNames.push_back(e);
+    }
+    for (const char* m : methods) {
+        features.methodHandlers[m] = [](const MeoFeatureCall&) {};
+    }
+    return features;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_schema_hash_ignores_order_and_sees_changes() {
+    uint32_t a = MeoRegistrationClient::schemaHash(makeFeatures({"temp", "humid"}, {"on", "off"}));
+    uint32_t b = MeoRegistrationClient::schemaHash(makeFeatures({"humid", "temp"}, {"off", "on"}));
+    TEST_ASSERT_EQUAL_UINT32(a, b);
+
+    uint32_t added = MeoRegistrationClient::schemaHash(makeFeatures({"humid", "temp"}, {"off", "on", "dim"}));
+    TEST_ASSERT_NOT_EQUAL(a, added);
+    // A name moving from events to methods is a different schema
+    uint32_t moved = MeoRegistrationClient::schemaHash(makeFeatures({"humid"}, {"off", "on", "temp"}));
+    TEST_ASSERT_NOT_EQUAL(a, moved);
+}
+
+void test_delta_without_stored_schema_replaces() {
+    MeoFeatureRegistry features = makeFeatures({"temp", "humid"}, {"on"});
+    MeoFeatureDelta delta = MeoRegistrationClient::computeDelta(features, false, "", "");
+
+    TEST_ASSERT_TRUE(delta.replace);
+    TEST_ASSERT_EQUAL_UINT32(MeoRegistrationClient::schemaHash(features), delta.schemaHash);
+    TEST_ASSERT_EQUAL_size_t(2, delta.addedEvents.size());
+    TEST_ASSERT_EQUAL_size_t(1, delta.addedMethods.size());
+    TEST_ASSERT_EQUAL_size_t(0, delta.removedEvents.size() + delta.removedMethods.size());
+}
+
+void test_delta_against_stored_schema() {
+    MeoFeatureRegistry features = makeFeatures({"humid", "pressure"}, {"on", "off"});
+    MeoFeatureDelta delta = MeoRegistrationClient::computeDelta(features, true, "humid,temp", "on,reset");
+
+    TEST_ASSERT_FALSE(delta.replace);
+    TEST_ASSERT_EQUAL_size_t(4, delta.size());
+    TEST_ASSERT_EQUAL_STRING("pressure", delta.addedEvents[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("temp", delta.removedEvents[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("off", delta.addedMethods[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("reset", delta.removedMethods[0].c_str());
+
+    // Nothing changed: empty delta
+    MeoFeatureDelta same = MeoRegistrationClient::computeDelta(
+        features, true, MeoRegistrationClient::joinEventNames(features),
+        MeoRegistrationClient::joinMethodNames(features));
+    TEST_ASSERT_EQUAL_size_t(0, same.size());
+}
+
+void test_retransmission_schedule_doubles_and_stops() {
+    const unsigned long expected[] = {0, 100, 300, 700, 1500, 3100};
+    uint8_t index = 0;
+    for (; index < sizeof(expected) / sizeof(expected[0]); index++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[index], MeoRegistrationClient::transmissionOffsetMs(index));
+    }
+    TEST_ASSERT_EQUAL_UINT32(MeoRegistrationClient::NO_TRANSMISSION,
+                             MeoRegistrationClient::transmissionOffsetMs(index));
+    TEST_ASSERT_EQUAL_UINT32(MeoRegistrationClient::NO_TRANSMISSION,
+                             MeoRegistrationClient::transmissionOffsetMs(255));
+}
+
+void test_split_pages() {
+    // Everything fits: one page, also when there is nothing to send
+    std::vector<size_t> pages = MeoRegistrationClient::splitPages({}, 100, 200);
+    TEST_ASSERT_EQUAL_size_t(1, pages.size());
+    pages = MeoRegistrationClient::splitPages({50, 50}, 100, 200);
+    TEST_ASSERT_EQUAL_size_t(1, pages.size());
+
+    // 100 + 40 + 40 fits, the third item does not
+    pages = MeoRegistrationClient::splitPages({40, 40, 40, 40, 40}, 100, 200);
+    TEST_ASSERT_EQUAL_size_t(3, pages.size());
+    TEST_ASSERT_EQUAL_size_t(0, pages[0]);
+    TEST_ASSERT_EQUAL_size_t(2, pages[1]);
+    TEST_ASSERT_EQUAL_size_t(4, pages[2]);
+
+    // An item larger than a page still gets sent, on a page of its own
+    pages = MeoRegistrationClient::splitPages({10, 500, 10}, 100, 200);
+    TEST_ASSERT_EQUAL_size_t(3, pages.size());
+    TEST_ASSERT_EQUAL_size_t(1, pages[1]);
+    TEST_ASSERT_EQUAL_size_t(2, pages[2]);
+}
+
+void test_discovery_pages_fit_a_datagram() {
+    MeoDeviceInfo info;
+    info.label = "Living Room Sensor";
+    info.model = "Model X";
+    info.manufacturer = "ThingAI Lab";
+
+    std::vector<String> names;
+    for (int i = 0; i < 80; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "feature_number_%03d", i);
+        names.push_back(name);
+    }
+    MeoFeatureRegistry features;
+    for (int i = 0; i < 80; i++) {
+        if (i % 4 == 0) {
+            features.eventNames.push_back(names[i]);
+        } else {
+            features.methodHandlers[names[i]] = [](const MeoFeatureCall&) {};
+        }
+    }
+
+    std::vector<String> pages;
+    TEST_ASSERT_TRUE(MeoRegistrationClient::buildDiscoveryPages(
+        info, features, "02:4D:45:4F:00:01", "192.168.1.50", 1234, true, pages));
+    TEST_ASSERT_TRUE(pages.size() > 1);
+
+    std::set<String> seen;
+    for (size_t page = 0; page < pages.size(); page++) {
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(MeoConfig::DISCOVERY_DATAGRAM_SIZE, pages[page].length());
+
+        DynamicJsonDocument doc(MeoConfig::DISCOVERY_DATAGRAM_SIZE * 2);
+        TEST_ASSERT_FALSE(deserializeJson(doc, pages[page]));
+        TEST_ASSERT_EQUAL_UINT32(1234, doc["discovery_id"].as<uint32_t>());
+        TEST_ASSERT_EQUAL_UINT32(MeoRegistrationClient::schemaHash(features), doc["schema_hash"].as<uint32_t>());
+        TEST_ASSERT_EQUAL_UINT32(page, doc["page"].as<uint32_t>());
+        TEST_ASSERT_EQUAL_UINT32(pages.size(), doc["pages"].as<uint32_t>());
+        for (JsonVariant v : doc["featureEvents"].as<JsonArray>()) {
+            TEST_ASSERT_TRUE(seen.insert(v.as<String>()).second);
+        }
+        for (JsonVariant v : doc["featureMethods"].as<JsonArray>()) {
+            TEST_ASSERT_TRUE(seen.insert(v.as<String>()).second);
+        }
+    }
+    // Every name sent exactly once
+    TEST_ASSERT_EQUAL_size_t(names.size(), seen.size());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_schema_hash_ignores_order_and_sees_changes);
+    RUN_TEST(test_delta_without_stored_schema_replaces);
+    RUN_TEST(test_delta_against_stored_schema);
+    RUN_TEST(test_retransmission_schedule_doubles_and_stops);
+    RUN_TEST(test_split_pages);
+    RUN_TEST(test_discovery_pages_fit_a_datagram);
+    return UNITY_END();
+}
@@ -0,0 +1,62 @@
+// MeoTimeSeries value range and MeoClock against the simulated millis().
+#include <unity.h>
+#include <Meo3_Time.h>
+#include <math.h>
+
+void setUp() {
+    meoTestSetMs(0);
+}
+
+void tearDown() {}
+
+void test_series_rounds_and_fills() {
+    MeoTimeSeries series("temperature", 100, 3);
+    TEST_ASSERT_TRUE(series.add(1000, 23.514f));
+    TEST_ASSERT_TRUE(series.add(2000, -0.006f));
+    TEST_ASSERT_TRUE(series.add(3000, 0.0f));
+    TEST_ASSERT_FALSE(series.add(4000, 1.0f));   // full
+
+    TEST_ASSERT_EQUAL_INT(2351, series.values()[0]);
+    TEST_ASSERT_EQUAL_INT(-1, series.values()[1]);
+    TEST_ASSERT_EQUAL_INT(0, series.values()[2]);
+
+    series.clear();
+    TEST_ASSERT_EQUAL_size_t(0, series.size());
+}
+
+void test_series_refuses_values_outside_int32() {
+    MeoTimeSeries series("pressure", 1000, 8);
+    TEST_ASSERT_FALSE(series.add(1000, 3.0e6f));    // 3e9 after scaling
+    TEST_ASSERT_FALSE(series.add(1000, -3.0e6f));
+    TEST_ASSERT_FALSE(series.add(1000, NAN));
+    TEST_ASSERT_FALSE(series.add(1000, INFINITY));
+    TEST_ASSERT_EQUAL_size_t(0, series.size());
+
+    // Both ends of the range are kept; their difference needs 64 bits
+    TEST_ASSERT_TRUE(series.add(1000, 2.0e6f));
+    TEST_ASSERT_TRUE(series.add(2000, -2.0e6f));
+    TEST_ASSERT_EQUAL_INT(2000000000, series.values()[0]);
+    TEST_ASSERT_EQUAL_INT(-2000000000, series.values()[1]);
+    int64_t dv = (int64_t)series.values()[1] - series.values()[0];
+    TEST_ASSERT_TRUE(dv == -4000000000LL);
+}
+
+void test_clock_follows_millis_after_sync() {
+    MeoClock clock;
+    TEST_ASSERT_FALSE(clock.isSynced());
+    TEST_ASSERT_TRUE(clock.nowMs() == 0);
+
+    meoTestSetMs(5000);
+    clock.syncTo(1700000000000ULL);
+    meoTestAdvanceMs(1234);
+    TEST_ASSERT_TRUE(clock.isSynced());
+    TEST_ASSERT_TRUE(clock.nowMs() == 1700000000000ULL + 1234);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_series_rounds_and_fills);
+    RUN_TEST(test_series_refuses_values_outside_int32);
+    RUN_TEST(test_clock_follows_millis_after_sync);
+    return UNITY_END();
+}
@@ -0,0 +1,138 @@
+// MeoTimerWheel against the simulated clock of the Arduino stub.
+#include <unity.h>
+#include <Meo3_Timer.h>
+#include <vector>
+
+static const uint32_t TICK = MeoConfig::TIMER_TICK_MS;
+static const uint32_t WHEEL_SPAN_MS = 64UL * 64 * 64 * TICK;   // beyond the top level
+
+// Moves the clock forward in steps, as loop() would, and runs what is due
+static void runFor(MeoTimerWheel& wheel, uint32_t ms, uint32_t stepMs = TICK) {
+    uint32_t end = millis() + ms;
+    while ((int32_t)(end - millis()) > 0) {
+        uint32_t step = end - millis() < stepMs ? end - millis() : stepMs;
+        meoTestAdvanceMs(step);
+        wheel.advance(millis());
+    }
+}
+
+void setUp() {
+    meoTestSetMs(0);
+}
+
+void tearDown() {}
+
+void test_one_shot_fires_once_on_time() {
+    MeoTimerWheel wheel;
+    int fired = 0;
+    uint32_t firedAt = 0;
+    MeoTimerId id = wheel.after(100, [&]() { fired++; firedAt = millis(); });
+    TEST_ASSERT_NOT_EQUAL(0, id);
+    TEST_ASSERT_TRUE(wheel.isActive(id));
+
+    runFor(wheel, 90);
+    TEST_ASSERT_EQUAL_INT(0, fired);
+    TEST_ASSERT_TRUE(wheel.msUntilNext() <= 10);
+
+    runFor(wheel, 1000);
+    TEST_ASSERT_EQUAL_INT(1, fired);
+    TEST_ASSERT_EQUAL_UINT32(100, firedAt);
+    TEST_ASSERT_FALSE(wheel.isActive(id));
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.activeCount());
+    TEST_ASSERT_EQUAL_UINT32(MeoTimerWheel::NO_DEADLINE, wheel.msUntilNext());
+}
+
+void test_periodic_timers_fire_aligned() {
+    MeoTimerWheel wheel;
+    std::vector<uint32_t> fast;
+    std::vector<uint32_t> slow;
+    wheel.every(1000, [&]() { fast.push_back(millis()); });
+    wheel.every(5000, [&]() { slow.push_back(millis()); });
+
+    runFor(wheel, 10000);
+    TEST_ASSERT_EQUAL_size_t(10, fast.size());
+    TEST_ASSERT_EQUAL_size_t(2, slow.size());
+    for (size_t i = 0; i < fast.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32((i + 1) * 1000, fast[i]);
+    }
+    // Same tick as the 1 s timer, so the radio wakes once
+    TEST_ASSERT_EQUAL_UINT32(5000, slow[0]);
+    TEST_ASSERT_EQUAL_UINT32(10000, slow[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, wheel.activeCount());
+}
+
+void test_cancel_before_and_inside_callback() {
+    MeoTimerWheel wheel;
+    int oneShot = 0;
+    int periodic = 0;
+    MeoTimerId a = wheel.after(500, [&]() { oneShot++; });
+    MeoTimerId b = 0;
+    b = wheel.every(100, [&]() {
+        if (++periodic == 3) wheel.cancel(b);
+    });
+
+    TEST_ASSERT_TRUE(wheel.cancel(a));
+    TEST_ASSERT_FALSE(wheel.cancel(a));   // already gone
+    TEST_ASSERT_FALSE(wheel.isActive(a));
+
+    runFor(wheel, 2000);
+    TEST_ASSERT_EQUAL_INT(0, oneShot);
+    TEST_ASSERT_EQUAL_INT(3, periodic);
+    TEST_ASSERT_FALSE(wheel.isActive(b));
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.activeCount());
+
+    // A freed slot is reused with a new id; the stale id stays invalid
+    MeoTimerId c = wheel.after(100, [&]() {});
+    TEST_ASSERT_NOT_EQUAL(a, c);
+    TEST_ASSERT_FALSE(wheel.cancel(a));
+    TEST_ASSERT_TRUE(wheel.isActive(c));
+}
+
+void test_time_jump_runs_overdue_timers_once() {
+    MeoTimerWheel wheel;
+    int periodic = 0;
+    int oneShot = 0;
+    wheel.every(1000, [&]() { periodic++; });
+    wheel.after(3000, [&]() { oneShot++; });
+
+    // loop() stalled for 10.5 s: missed periods are skipped, not replayed
+    meoTestAdvanceMs(10500);
+    uint32_t untilNext = wheel.advance(millis());
+    TEST_ASSERT_EQUAL_INT(1, periodic);
+    TEST_ASSERT_EQUAL_INT(1, oneShot);
+    // Back on the 1 s grid; the hint may be early (cascade) but never late
+    TEST_ASSERT_TRUE(untilNext > 0 && untilNext <= 500);
+
+    runFor(wheel, 490);
+    TEST_ASSERT_EQUAL_INT(1, periodic);
+    runFor(wheel, 10);
+    TEST_ASSERT_EQUAL_INT(2, periodic);
+}
+
+void test_delay_beyond_the_top_level() {
+    MeoTimerWheel wheel;
+    const uint32_t delayMs = WHEEL_SPAN_MS + 123450;
+    int fired = 0;
+    uint32_t firedAt = 0;
+    wheel.after(delayMs, [&]() { fired++; firedAt = millis(); });
+    TEST_ASSERT_TRUE(wheel.msUntilNext() <= delayMs);
+
+    // Coarse steps through the cascades, then tick by tick near the deadline
+    runFor(wheel, delayMs - 1000, 10000);
+    TEST_ASSERT_EQUAL_INT(0, fired);
+    TEST_ASSERT_TRUE(wheel.msUntilNext() <= 1000);
+
+    runFor(wheel, 2000);
+    TEST_ASSERT_EQUAL_INT(1, fired);
+    TEST_ASSERT_EQUAL_UINT32(delayMs, firedAt);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_shot_fires_once_on_time);
+    RUN_TEST(test_periodic_timers_fire_aligned);
+    RUN_TEST(test_cancel_before_and_inside_callback);
+    RUN_TEST(test_time_jump_runs_overdue_timers_once);
+    RUN_TEST(test_delay_beyond_the_top_level);
+    return UNITY_END();
+}